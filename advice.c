@@ -0,0 +1,241 @@
+/*
+ *  File:  advice.c
+ *
+ *  Description:  This file contains VmAdvise, which lets a process tell
+ *                the pager how it will use its pages, and VmPopulate,
+ *                which brings a range of pages in ahead of their use
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "mapping.h"
+#include "prefetch.h"
+#include "swapCache.h"
+#include "swap.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int VMInitialized;
+extern Frame *FrameTable;
+extern int FramesMutex;
+extern int releaseFrame(int);
+extern void populatePage(int, int);
+extern void mapResident(int);
+
+/*
+ * The usage hints are kept in each page table entry: swapRead skips the
+ * read-ahead for random pages, and frameLoaded makes the page before a
+ * sequential page the next victim. Shared pages and segment pages belong
+ * to other processes too, so only private pages are fetched or dropped.
+ */
+static int fetchPage(int, int);
+static int dropPage(int, int, int);
+static void unmapPage(int);
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmAdviseReal --
+ *
+ * Called by vmAdvise.
+ * Applies the given hint to the given range of the current process's VM
+ * region. VM_ADV_WILLNEED brings the pages that are on disk into free
+ * frames, without evicting anything. VM_ADV_DONTNEED discards the
+ * contents of the pages and frees their frames and swap space.
+ * VM_ADV_FREE frees their swap space at once and leaves the pages in
+ * memory, to be dropped instead of written out unless they are written
+ * again first. Pages of mapped disk regions are written back instead of
+ * being discarded.
+ *
+ * Results:
+ *      0 on success, -1 if the range or the hint is invalid.
+ *
+ * Side effects:
+ *      A page whose contents were discarded reads as zeros.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmAdviseReal(void *addr, int pages, int hint)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || hint < VM_ADV_NORMAL || hint > VM_ADV_FREE ||
+            !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    int pid = getpid();
+    Process *proc = getProc(pid);
+    int count = 0;
+    for (int i = start; i < start + pages; i++)
+    {
+        if (hint == VM_ADV_WILLNEED)
+        {
+            count += fetchPage(pid, i);
+        }
+        else if (hint == VM_ADV_DONTNEED || hint == VM_ADV_FREE)
+        {
+            count += dropPage(pid, i, hint == VM_ADV_FREE);
+        }
+        else
+        {
+            proc->pageTable[i].advice = hint;
+        }
+    }
+
+    lockMutex(vmStatsMutex);
+    if (hint == VM_ADV_WILLNEED)
+    {
+        vmStats.advisedFetches += count;
+    }
+    else
+    {
+        vmStats.advisedDrops += count;
+    }
+    unlockMutex(vmStatsMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmAdviseReal(): Hint %d for pages %d to %d of pid %d, %d pages affected.\n", hint, start, start + pages - 1, pid, count);
+    }
+    return 0;
+} /* vmAdviseReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmPopulateReal --
+ *
+ * Called by vmPopulate.
+ * Brings every page in the given range of the current process's VM
+ * region into memory and maps it, in page order, so that first touches
+ * do not fault. Unused pages are zero-filled, or mapped to the shared
+ * zero frame unless write is set; pages on disk are read in, and reads
+ * of neighbouring swap blocks are served by the read-ahead. If write is
+ * set, shared pages are copied into private frames too.
+ *
+ * Results:
+ *      0 on success, -1 if the range is invalid.
+ *
+ * Side effects:
+ *      Pages of other processes may be replaced.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmPopulateReal(void *addr, int pages, int write)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    for (int i = start; i < start + pages; i++)
+    {
+        populatePage(i, write);
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmPopulateReal(): Populated pages %d to %d for pid %d.\n", start, start + pages - 1, getpid());
+    }
+    return 0;
+} /* vmPopulateReal */
+
+/*
+ *  Bring the given page of the process with the given pid into a free frame
+ *  if it is on disk, and map it. Returns TRUE if the page was brought in.
+ */
+static int fetchPage(int pid, int pageNum)
+{
+    if (!prefetchPage(pid, pageNum))
+    {
+        return FALSE;
+    }
+    mapResident(pageNum);
+    return TRUE;
+}
+
+/*
+ *  Drop the given private page of the process with the given pid. Its swap
+ *  space is freed, and so is its frame unless lazy is set, in which case the
+ *  page is left in memory clean and at the front of the victims. Returns
+ *  TRUE if contents were discarded.
+ */
+static int dropPage(int pid, int pageNum, int lazy)
+{
+    PTE *pte = &getProc(pid)->pageTable[pageNum];
+    if (pte->state == UNUSED || pte->cow || pte->segment != EMPTY || pte->pinned)
+    {
+        return FALSE;
+    }
+    int mapped = pte->mapUnit != EMPTY;
+
+    int frame = holdPage(pte);
+    if (frame == EMPTY)
+    {
+        // The page is on disk; its copy there is all there is to drop
+        if (mapped)
+        {
+            return FALSE;
+        }
+        swapFree(pte);
+        cacheDrop(pid, pageNum);
+        return TRUE;
+    }
+
+    int access = getFrameAccess(frame);
+    if (!mapped)
+    {
+        access &= ~USLOSS_MMU_DIRTY;
+        swapFree(pte);
+    }
+    if (lazy)
+    {
+        setFrameAccess(frame, access & ~USLOSS_MMU_REF);
+        lockMutex(FramesMutex);
+        FrameTable[frame].warm = FALSE;
+        pte->lastRef = 0;
+        unlockMutex(FramesMutex);
+        releasePage(frame);
+        return !mapped;
+    }
+    setFrameAccess(frame, access);
+    unmapPage(pageNum);
+    if (!releaseFrame(frame))
+    {
+        USLOSS_Console("dropPage(): Swap disk has run out of space.\n");
+        USLOSS_Halt(1);
+    }
+    return !mapped;
+}
+
+/*
+ *  Remove the current process's mapping of the given page, if it has one
+ */
+static void unmapPage(int pageNum)
+{
+    int mapped;
+    int protection;
+    if (USLOSS_MmuGetMap(TAG, pageNum, &mapped, &protection) == USLOSS_MMU_ERR_NOMAP)
+    {
+        return;
+    }
+    int result = USLOSS_MmuUnmap(TAG, pageNum);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("unmapPage(): Could not perform unmapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ *  File:  compression.c
+ *
+ *  Description:  This file contains the run-length codec used to compress
+ *                pages that are swapped out
+ *
+ */
+
+#include <usloss.h>
+#include <string.h>
+
+#include "compression.h"
+
+/*
+ * The compressed form is a sequence of runs. A control byte below 128 is
+ * followed by that many plus one literal bytes. A control byte of 128 or
+ * above is followed by a single byte that is repeated (control - 125) times.
+ */
+#define MAX_LITERALS 128
+#define MIN_REPEAT   3
+#define MAX_REPEAT   130
+
+/*
+ *  Compress one page into out, which holds max bytes.
+ *  Returns the compressed length, or -1 if it would not fit.
+ */
+int compressPage(char *page, char *out, int max)
+{
+    int pageSize = USLOSS_MmuPageSize();
+    int length = 0;
+    int i = 0;
+    while (i < pageSize)
+    {
+        // Measure the run starting here
+        int run = 1;
+        while (i + run < pageSize && run < MAX_REPEAT && page[i + run] == page[i])
+        {
+            run++;
+        }
+
+        if (run >= MIN_REPEAT)
+        {
+            if (length + 2 > max)
+            {
+                return -1;
+            }
+            out[length++] = (char) (run + 125);
+            out[length++] = page[i];
+            i += run;
+            continue;
+        }
+
+        // Collect literals up to the next run worth encoding
+        int start = i;
+        while (i < pageSize && i - start < MAX_LITERALS)
+        {
+            if (i + 2 < pageSize && page[i] == page[i + 1] && page[i] == page[i + 2])
+            {
+                break;
+            }
+            i++;
+        }
+        int literals = i - start;
+        if (length + 1 + literals > max)
+        {
+            return -1;
+        }
+        out[length++] = (char) (literals - 1);
+        memcpy(out + length, page + start, literals);
+        length += literals;
+    }
+    return length;
+}
+
+/*
+ *  Expand length bytes produced by compressPage back into a full page
+ */
+void decompressPage(char *in, int length, char *page)
+{
+    int pageSize = USLOSS_MmuPageSize();
+    int i = 0;
+    int out = 0;
+    while (i < length && out < pageSize)
+    {
+        int control = (unsigned char) in[i++];
+        if (control < MAX_LITERALS)
+        {
+            int literals = control + 1;
+            memcpy(page + out, in + i, literals);
+            i += literals;
+            out += literals;
+        }
+        else
+        {
+            int run = control - 125;
+            memset(page + out, in[i++], run);
+            out += run;
+        }
+    }
+    if (out != pageSize)
+    {
+        USLOSS_Console("decompressPage(): Page expanded to %d bytes.\n", out);
+        USLOSS_Halt(1);
+    }
+}
@@ -0,0 +1,10 @@
+/*
+ * compression.h
+ */
+
+#ifndef _COMPRESSION_H
+#define _COMPRESSION_H
+
+extern int compressPage(char *, char *, int);
+extern void decompressPage(char *, int, char *);
+#endif
@@ -31,5 +31,19 @@ extern int  TermWrite(char *buff, int bsize, int unit_id, int *nwrite);
 // Phase 5 -- User Function Prototypes
 extern int VmInit(int, int, int, int, void **);
 extern int VmDestroy(void);
+extern int VmLimit(int pid, int minFrames, int maxFrames);
+extern int VmShmCreate(char *name, int pages, int *segment);
+extern int VmShmAttach(int segment, void *addr);
+extern int VmShmDetach(int segment);
+extern int VmSpawn(char *name, int (*func)(char *), char *arg, int stack_size,
+                   int priority, int *pid);
+extern int VmMap(int unit, int track, int first, int pages, void *addr);
+extern int VmSync(void *addr, int pages);
+extern int VmUnmap(void *addr, int pages);
+extern int VmAdvise(void *addr, int pages, int hint);    // pages, not bytes
+extern int VmLock(void *addr, int pages);
+extern int VmUnlock(void *addr, int pages);
+extern int VmPopulate(void *addr, int pages, int write); // pages, not bytes
+extern int VmResident(void *addr, int pages, char *vec);
 
 #endif
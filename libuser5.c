@@ -241,4 +241,358 @@ VmDestroy(void) {
 } /* VmDestroy */
 
 
+/*
+ *  Routine:  VmLimit
+ *
+ *  Description: Sets the physical memory limits of a process
+ *
+ *  Arguments:    int pid -- process to limit
+ *                int minFrames -- # frames reserved for the process
+ *                int maxFrames -- most frames the process may hold, -1
+ *                                 for no limit
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmLimit(int pid, int minFrames, int maxFrames)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMLIMIT;
+    sysArg.arg1 = (void *) (long) pid;
+    sysArg.arg2 = (void *) (long) minFrames;
+    sysArg.arg3 = (void *) (long) maxFrames;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmLimit */
+
+
+/*
+ *  Routine:  VmShmCreate
+ *
+ *  Description: Creates a named shared memory segment, or finds the
+ *               existing segment with the name
+ *
+ *  Arguments:    char *name -- name of the segment
+ *                int pages -- # pages in the segment
+ *                int *segment -- pointer to output value
+ *                (output value: id of the segment)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmShmCreate(char *name, int pages, int *segment)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMSHMCREATE;
+    sysArg.arg1 = (void *) name;
+    sysArg.arg2 = (void *) (long) pages;
+    USLOSS_Syscall(&sysArg);
+    *segment = (int) (long) sysArg.arg1;
+    return (int) (long) sysArg.arg4;
+} /* VmShmCreate */
+
+
+/*
+ *  Routine:  VmShmAttach
+ *
+ *  Description: Attaches a shared memory segment to the VM region of the
+ *               calling process
+ *
+ *  Arguments:    int segment -- id of the segment
+ *                void *addr -- page-aligned address in the VM region to
+ *                              attach the segment at
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmShmAttach(int segment, void *addr)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMSHMATTACH;
+    sysArg.arg1 = (void *) (long) segment;
+    sysArg.arg2 = addr;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmShmAttach */
+
+
+/*
+ *  Routine:  VmShmDetach
+ *
+ *  Description: Detaches a shared memory segment from the calling
+ *               process. The segment is destroyed once no process is
+ *               attached.
+ *
+ *  Arguments:    int segment -- id of the segment
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmShmDetach(int segment)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMSHMDETACH;
+    sysArg.arg1 = (void *) (long) segment;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmShmDetach */
+
+
+/*
+ *  Routine:  VmSpawn
+ *
+ *  Description: Spawns a child process that starts with a copy-on-write
+ *               clone of the caller's VM region
+ *
+ *  Arguments:    char *name -- name of the child
+ *                int (*func)(char *) -- function the child runs
+ *                char *arg -- argument to the function
+ *                int stack_size -- size of the child's stack
+ *                int priority -- priority of the child
+ *                int *pid -- pointer to output value
+ *                (output value: pid of the child)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmSpawn(char *name, int (*func)(char *), char *arg, int stack_size,
+            int priority, int *pid)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMSPAWN;
+    sysArg.arg1 = (void *) func;
+    sysArg.arg2 = (void *) arg;
+    sysArg.arg3 = (void *) (long) stack_size;
+    sysArg.arg4 = (void *) (long) priority;
+    sysArg.arg5 = (void *) name;
+    USLOSS_Syscall(&sysArg);
+    *pid = (int) (long) sysArg.arg1;
+    return (int) (long) sysArg.arg4;
+} /* VmSpawn */
+
+
+/*
+ *  Routine:  VmMap
+ *
+ *  Description: Maps a range of sectors of a disk into the VM region of
+ *               the calling process. The pages are read from the disk when
+ *               first touched and dirty pages are written back to it.
+ *
+ *  Arguments:    int unit -- disk unit to map
+ *                int track -- track of the first sector
+ *                int first -- first sector within the track
+ *                int pages -- number of pages to map
+ *                void *addr -- page-aligned address in the VM region to
+ *                              map the disk at
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmMap(int unit, int track, int first, int pages, void *addr)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMMAP;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) unit;
+    sysArg.arg3 = (void *) (long) track;
+    sysArg.arg4 = (void *) (long) first;
+    sysArg.arg5 = (void *) (long) pages;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmMap */
+
+
+/*
+ *  Routine:  VmSync
+ *
+ *  Description: Writes the dirty mapped pages in a range of the VM region
+ *               back to their disk
+ *
+ *  Arguments:    void *addr -- page-aligned address of the range
+ *                int pages -- number of pages in the range
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmSync(void *addr, int pages)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMSYNC;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) pages;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmSync */
+
+
+/*
+ *  Routine:  VmUnmap
+ *
+ *  Description: Writes back and removes the disk mappings in a range of
+ *               the VM region
+ *
+ *  Arguments:    void *addr -- page-aligned address of the range
+ *                int pages -- number of pages in the range
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmUnmap(void *addr, int pages)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMUNMAP;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) pages;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmUnmap */
+
+
+/*
+ *  Routine:  VmAdvise
+ *
+ *  Description: Tells the pager how a range of the VM region will be used,
+ *               or that its pages are wanted now or no longer needed
+ *
+ *  Arguments:    void *addr -- page-aligned address of the range
+ *                int pages -- number of pages in the range
+ *                int hint -- one of the VM_ADV_ hints in phase5.h
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmAdvise(void *addr, int pages, int hint)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMADVISE;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) pages;
+    sysArg.arg3 = (void *) (long) hint;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmAdvise */
+
+
+/*
+ *  Routine:  VmLock
+ *
+ *  Description: Brings a range of the VM region into memory and pins it
+ *               there, so that using it never faults
+ *
+ *  Arguments:    void *addr -- page-aligned address of the range
+ *                int pages -- number of pages in the range
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmLock(void *addr, int pages)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMLOCK;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) pages;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmLock */
+
+
+/*
+ *  Routine:  VmUnlock
+ *
+ *  Description: Unpins a range of the VM region pinned by VmLock
+ *
+ *  Arguments:    void *addr -- page-aligned address of the range
+ *                int pages -- number of pages in the range
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmUnlock(void *addr, int pages)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMUNLOCK;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) pages;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmUnlock */
+
+
+/*
+ *  Routine:  VmPopulate
+ *
+ *  Description: Brings a range of the VM region into memory in one call,
+ *               so that first touching it does not fault
+ *
+ *  Arguments:    void *addr -- page-aligned address of the range
+ *                int pages -- number of pages in the range
+ *                int write -- nonzero if the pages will be written
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmPopulate(void *addr, int pages, int write)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMPOPULATE;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) pages;
+    sysArg.arg3 = (void *) (long) write;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmPopulate */
+
+
+/*
+ *  Routine:  VmResident
+ *
+ *  Description: Reports which pages of a range of the VM region are in
+ *               memory, dirty, on disk or pinned, without touching them
+ *
+ *  Arguments:    void *addr -- page-aligned address of the range
+ *                int pages -- number of pages in the range
+ *                char *vec -- one byte per page, set to VM_RES_ bits;
+ *                             must lie outside the VM region
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmResident(void *addr, int pages, char *vec)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_VMRESIDENT;
+    sysArg.arg1 = addr;
+    sysArg.arg2 = (void *) (long) pages;
+    sysArg.arg3 = vec;
+    USLOSS_Syscall(&sysArg);
+    return (int) (long) sysArg.arg4;
+} /* VmResident */
+
+
 /* end libuser.c */
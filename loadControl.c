@@ -0,0 +1,287 @@
+/*
+ *  File:  loadControl.c
+ *
+ *  Description:  This file contains the load control that deactivates
+ *                processes while the system is thrashing
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "replacement.h"
+#include "loadControl.h"
+#include "vm.h"
+
+extern int NumFrames;
+extern int debugflag5;
+extern int swapOutProcess(int);
+
+static int LoadMutex;
+static int WindowStart;     // Start of the current sampling window
+static int PagingTime;      // Time spent handling faults during the window
+static int Deactivations;   // Used to order deactivated processes
+
+/*
+ * The pagers check the load after each fault. The monitor checks it once
+ * per clock interrupt as well, so deactivated processes are let back in
+ * even when the active ones have stopped faulting.
+ */
+static int MonitorPID = EMPTY;
+static int MonitorDoneSem;  // V'd by the monitor when it quits
+static int MonitorQuit;
+
+static void endWindow();
+static int LoadMonitor(char *);
+static int chooseVictim();
+static void reactivateOldest();
+
+/*
+ *  Initialize the load control state and start the monitor, if enabled
+ */
+void initLoadControl()
+{
+    LoadMutex = createMutex();
+    WindowStart = currentTime();
+    PagingTime = 0;
+    Deactivations = 0;
+    MonitorPID = EMPTY;
+    if (!LoadControl)
+    {
+        return;
+    }
+    MonitorDoneSem = semcreateReal(0);
+    MonitorQuit = FALSE;
+    MonitorPID = fork1("LoadMonitor", LoadMonitor, NULL, USLOSS_MIN_STACK, LOAD_MONITOR_PRIORITY);
+    if (MonitorPID < 0)
+    {
+        USLOSS_Console("initLoadControl(): Can't create the load monitor.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ *  Stop the load monitor. Must be called before the MMU is turned off.
+ */
+void stopLoadControl()
+{
+    if (MonitorPID == EMPTY)
+    {
+        return;
+    }
+    MonitorQuit = TRUE;
+    sempReal(MonitorDoneSem);
+    zap(MonitorPID);  // the caller may not quit before its child does
+    semfreeReal(MonitorDoneSem);
+    MonitorPID = EMPTY;
+}
+
+/*
+ *  Called by a pager after handling a fault that took the given time
+ */
+void checkLoad(int faultTime)
+{
+    if (!LoadControl)
+    {
+        return;
+    }
+
+    lockMutex(LoadMutex);
+    PagingTime += faultTime;
+    unlockMutex(LoadMutex);
+    endWindow();
+}
+
+/*
+ *  Once per window, deactivates a process if the pagers were busy for most
+ *  of the window and the working sets no longer fit in memory, or lets a
+ *  deactivated process back in if the pagers were mostly idle.
+ */
+static void endWindow()
+{
+    lockMutex(LoadMutex);
+    int now = currentTime();
+    int elapsed = now - WindowStart;
+    if (elapsed < LOAD_WINDOW)
+    {
+        unlockMutex(LoadMutex);
+        return;
+    }
+    int paging = (int) ((long) PagingTime * 100 / elapsed);
+    WindowStart = now;
+    PagingTime = 0;
+
+    int victim = EMPTY;
+    if (paging >= THRASH_HIGH)
+    {
+        victim = chooseVictim();
+    }
+    else if (paging <= THRASH_LOW)
+    {
+        reactivateOldest();
+    }
+    unlockMutex(LoadMutex);
+
+    // Free the victim's frames for everyone else
+    if (victim != EMPTY)
+    {
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("endWindow(): Paging for %d%% of the window, deactivating pid %d.\n", paging, victim);
+        }
+        swapOutProcess(victim);
+    }
+}
+
+/*
+ *  Kernel process that checks the load on every clock interrupt
+ */
+static int LoadMonitor(char *arg)
+{
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("LoadMonitor(): called.\n");
+    }
+    while (!MonitorQuit)
+    {
+        int status;
+        waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+        if (!MonitorQuit)
+        {
+            endWindow();
+        }
+    }
+    semvReal(MonitorDoneSem);
+    return 0;
+}
+
+/*
+ *  Block the calling process if load control has deactivated it, until it
+ *  is reactivated
+ */
+void waitIfDeactivated(int pid)
+{
+    if (!LoadControl)
+    {
+        return;
+    }
+
+    Process *proc = getProc(pid);
+    lockMutex(LoadMutex);
+    if (proc->deactivated)
+    {
+        proc->held = TRUE;
+        unlockMutex(LoadMutex);
+        semPProc();
+        return;
+    }
+    unlockMutex(LoadMutex);
+}
+
+/*
+ *  Called when the process with the given pid quits. Its frames are about to
+ *  be freed, so a deactivated process can be let back in.
+ */
+void loadControlQuit(int pid)
+{
+    if (!LoadControl)
+    {
+        return;
+    }
+
+    lockMutex(LoadMutex);
+    getProc(pid)->deactivated = 0;
+    reactivateOldest();
+    unlockMutex(LoadMutex);
+}
+
+/*
+ *  Pick an active process to deactivate, or EMPTY if the working sets of the
+ *  active processes fit in memory or only one is left. Phase 1 does not expose
+ *  priorities, so the most recently created process is chosen.
+ *  Must be called with the load mutex held.
+ */
+static int chooseVictim()
+{
+    int demand = 0;
+    int active = 0;
+    int victim = EMPTY;
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        if (proc->pid == EMPTY || proc->deactivated)
+        {
+            continue;
+        }
+        int size = workingSetSize(proc->pid);
+        if (size == 0)
+        {
+            continue;
+        }
+        demand += size;
+        active++;
+
+        // Processes with reserved frames are never swapped out
+        if (proc->minFrames > 0)
+        {
+            continue;
+        }
+        if (victim == EMPTY || proc->pid > victim)
+        {
+            victim = proc->pid;
+        }
+    }
+    if (demand <= NumFrames || active < 2 || victim == EMPTY)
+    {
+        return EMPTY;
+    }
+
+    getProc(victim)->deactivated = ++Deactivations;
+    lockMutex(vmStatsMutex);
+    vmStats.deactivations++;
+    unlockMutex(vmStatsMutex);
+    return victim;
+}
+
+/*
+ *  Reactivate the process that has been deactivated the longest, if any.
+ *  Must be called with the load mutex held.
+ */
+static void reactivateOldest()
+{
+    Process *oldest = NULL;
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        if (proc->pid != EMPTY && proc->deactivated &&
+                (oldest == NULL || proc->deactivated < oldest->deactivated))
+        {
+            oldest = proc;
+        }
+    }
+    if (oldest == NULL)
+    {
+        return;
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("reactivateOldest(): Reactivating pid %d.\n", oldest->pid);
+    }
+    oldest->deactivated = 0;
+    if (oldest->held)
+    {
+        oldest->held = FALSE;
+        semVProc(oldest->pid);
+    }
+    lockMutex(vmStatsMutex);
+    vmStats.reactivations++;
+    unlockMutex(vmStatsMutex);
+}
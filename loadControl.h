@@ -0,0 +1,13 @@
+/*
+ * loadControl.h
+ */
+
+#ifndef _LOADCONTROL_H
+#define _LOADCONTROL_H
+
+extern void initLoadControl();
+extern void stopLoadControl();
+extern void checkLoad(int);
+extern void waitIfDeactivated(int);
+extern void loadControlQuit(int);
+#endif
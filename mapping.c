@@ -0,0 +1,370 @@
+/*
+ *  File:  mapping.c
+ *
+ *  Description:  This file contains the disk regions mapped into the VM
+ *                region, whose pages the pagers load from and write back
+ *                to the mapped disk
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "mapping.h"
+#include "pinning.h"
+#include "replacement.h"
+#include "swap.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int VMInitialized;
+extern Frame *FrameTable;
+extern int NumPages;
+extern int FramesMutex;
+
+/*
+ * A mapped page is kept on its disk instead of in swap space: the page
+ * table entry names the unit and the first sector of the page, and the
+ * page is ONDISK whenever it is not in memory. Pages of one mapping are
+ * consecutive on the disk, SectorsPerPage sectors apart.
+ */
+static int SectorsPerPage;
+
+static void writeBack(int, int);
+static void transfer(int, PTE *, char *);
+
+/*
+ *  Initialize the disk mappings
+ */
+void initMappings()
+{
+    SectorsPerPage = USLOSS_MmuPageSize() / USLOSS_DISK_SECTOR_SIZE;
+}
+
+/*
+ *  Read the mapped page of the given page table entry from its disk into
+ *  the buffer
+ */
+void readMappedPage(char *buffer, PTE *pte)
+{
+    transfer(FALSE, pte, buffer);
+
+    lockMutex(vmStatsMutex);
+    vmStats.pageIns++;
+    vmStats.mappedReads++;
+    unlockMutex(vmStatsMutex);
+}
+
+/*
+ *  Write the buffer to the mapped page of the given page table entry
+ */
+void writeMappedPage(char *buffer, PTE *pte)
+{
+    transfer(TRUE, pte, buffer);
+
+    lockMutex(vmStatsMutex);
+    vmStats.mappedWrites++;
+    unlockMutex(vmStatsMutex);
+}
+
+/*
+ *  Write back the dirty mapped pages of the process with the given pid.
+ *  Must be called by the process itself while its mappings are loaded.
+ */
+void syncMappings(int pid)
+{
+    for (int i = 0; i < NumPages; i++)
+    {
+        if (getProc(pid)->pageTable[i].mapUnit != EMPTY)
+        {
+            writeBack(pid, i);
+        }
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmMapReal --
+ *
+ * Called by vmMap.
+ * Maps the given number of pages of a disk, starting at the given track
+ * and sector, into the VM region of the current process at the given
+ * page-aligned address. The pages must not have been used yet. A disk
+ * that holds swap space cannot be mapped.
+ *
+ * Results:
+ *      0 on success, -1 if the arguments are invalid.
+ *
+ * Side effects:
+ *      The pages are read from the disk when they are first touched.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmMapReal(int unit, int track, int first, int pages, void *addr)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || unit < 0 || unit >= USLOSS_DISK_UNITS || isSwapUnit(unit) ||
+            !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    int sectorSize;
+    int trackSize;
+    int tracks;
+    if (diskSizeReal(unit, &sectorSize, &trackSize, &tracks) != 0 || track < 0 ||
+            first < 0 || first >= trackSize ||
+            (track * trackSize + first) + pages * SectorsPerPage > tracks * trackSize)
+    {
+        return -1;
+    }
+
+    Process *proc = getProc(getpid());
+    lockMutex(FramesMutex);
+    for (int i = start; i < start + pages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        if (pte->state != UNUSED || pte->segment != EMPTY || pte->mapUnit != EMPTY)
+        {
+            unlockMutex(FramesMutex);
+            return -1;
+        }
+    }
+    for (int i = 0; i < pages; i++)
+    {
+        PTE *pte = &proc->pageTable[start + i];
+        pte->state = ONDISK;
+        pte->mapUnit = unit;
+        pte->mapSector = track * trackSize + first + i * SectorsPerPage;
+    }
+    unlockMutex(FramesMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmMapReal(): Mapped %d pages of disk %d at page %d for pid %d.\n", pages, unit, start, getpid());
+    }
+    return 0;
+} /* vmMapReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmSyncReal --
+ *
+ * Called by vmSync.
+ * Writes the dirty mapped pages in the given range of the current
+ * process's VM region back to their disk.
+ *
+ * Results:
+ *      0 on success, -1 if the range is invalid.
+ *
+ * Side effects:
+ *      The pages written are clean afterwards.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmSyncReal(void *addr, int pages)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    int pid = getpid();
+    for (int i = start; i < start + pages; i++)
+    {
+        if (getProc(pid)->pageTable[i].mapUnit != EMPTY)
+        {
+            writeBack(pid, i);
+        }
+    }
+    return 0;
+} /* vmSyncReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmUnmapReal --
+ *
+ * Called by vmUnmap.
+ * Removes the disk mappings in the given range of the current process's
+ * VM region, writing dirty pages back to their disk first.
+ *
+ * Results:
+ *      0 on success, -1 if the range is invalid.
+ *
+ * Side effects:
+ *      The frames of the unmapped pages are freed and the pages become
+ *      unused.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmUnmapReal(void *addr, int pages)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    int pid = getpid();
+    Process *proc = getProc(pid);
+    for (int i = start; i < start + pages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        if (pte->mapUnit == EMPTY)
+        {
+            continue;
+        }
+        writeBack(pid, i);
+
+        int frame = holdPage(pte);
+        lockMutex(FramesMutex);
+        if (frame != EMPTY)
+        {
+            // A page that was prefetched or populated may not be mapped yet
+            int mapped;
+            int protection;
+            if (USLOSS_MmuGetMap(TAG, i, &mapped, &protection) == USLOSS_MMU_OK)
+            {
+                int result = USLOSS_MmuUnmap(TAG, i);
+                if (result != USLOSS_MMU_OK)
+                {
+                    USLOSS_Console("vmUnmapReal(): Could not perform unmapping. Error code %d.\n", result);
+                    USLOSS_Halt(1);
+                }
+            }
+            FrameTable[frame].page = EMPTY;
+            FrameTable[frame].pid = EMPTY;
+            setFrameList(frame, EMPTY);
+            FrameTable[frame].warm = FALSE;
+            FrameTable[frame].locked = FALSE;
+            setFrameAccess(frame, 0);
+        }
+        unpinPage(proc, pte);
+        pte->state = UNUSED;
+        pte->frame = EMPTY;
+        pte->mapUnit = EMPTY;
+        pte->mapSector = 0;
+        unlockMutex(FramesMutex);
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmUnmapReal(): Unmapped pages %d to %d for pid %d.\n", start, start + pages - 1, pid);
+    }
+    return 0;
+} /* vmUnmapReal */
+
+/*
+ *  Find the first page of the given range of the VM region. Returns FALSE
+ *  if the address is not page-aligned or the range does not fit.
+ */
+int pageRange(void *addr, int pages, int *start)
+{
+    int dummy;
+    long offset = (char *) addr - (char *) USLOSS_MmuRegion(&dummy);
+    if (pages < 1 || offset < 0 || offset % USLOSS_MmuPageSize() != 0)
+    {
+        return FALSE;
+    }
+    *start = offset / USLOSS_MmuPageSize();
+    return *start + pages <= NumPages;
+}
+
+/*
+ *  Lock the frame of the given page once no pager is using it and it is
+ *  not moving to or from disk. Returns the frame, or EMPTY if the page is
+ *  not in memory.
+ */
+int holdPage(PTE *pte)
+{
+    lockMutex(FramesMutex);
+    while (pte->loading || (pte->frame != EMPTY && FrameTable[pte->frame].locked))
+    {
+        unlockMutex(FramesMutex);
+        int status;
+        waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+        lockMutex(FramesMutex);
+    }
+    int frame = pte->frame;
+    if (frame != EMPTY)
+    {
+        FrameTable[frame].locked = TRUE;
+    }
+    unlockMutex(FramesMutex);
+    return frame;
+}
+
+/*
+ *  Unlock a frame locked by holdPage
+ */
+void releasePage(int frame)
+{
+    lockMutex(FramesMutex);
+    FrameTable[frame].locked = FALSE;
+    unlockMutex(FramesMutex);
+}
+
+/*
+ *  Write the given mapped page of the process with the given pid back to
+ *  its disk if it is in memory and dirty. The page is read through the
+ *  process's own mapping.
+ */
+static void writeBack(int pid, int pageNum)
+{
+    PTE *pte = &getProc(pid)->pageTable[pageNum];
+    int frame = holdPage(pte);
+    if (frame == EMPTY)
+    {
+        return;
+    }
+    int access = getFrameAccess(frame);
+    if (access & USLOSS_MMU_DIRTY)
+    {
+        char buffer[USLOSS_MmuPageSize()];
+        memcpy(buffer, page(pageNum), USLOSS_MmuPageSize());
+        setFrameAccess(frame, access & ~USLOSS_MMU_DIRTY);
+        writeMappedPage(buffer, pte);
+
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("writeBack(): Wrote page %d of pid %d to disk %d.\n", pageNum, pid, pte->mapUnit);
+        }
+    }
+    releasePage(frame);
+}
+
+/*
+ *  Read or write the mapped page of the given page table entry
+ */
+static void transfer(int write, PTE *pte, char *buffer)
+{
+    int sectorSize;
+    int trackSize;
+    int tracks;
+    diskSizeReal(pte->mapUnit, &sectorSize, &trackSize, &tracks);
+    int track = pte->mapSector / trackSize;
+    int sector = pte->mapSector % trackSize;
+    if (write)
+    {
+        diskWriteReal(pte->mapUnit, track, sector, SectorsPerPage, buffer);
+    }
+    else
+    {
+        diskReadReal(pte->mapUnit, track, sector, SectorsPerPage, buffer);
+    }
+}
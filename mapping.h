@@ -0,0 +1,17 @@
+/*
+ * mapping.h
+ */
+
+#ifndef _MAPPING_H
+#define _MAPPING_H
+
+#include "vm.h"
+
+extern void initMappings();
+extern void readMappedPage(char *, PTE *);
+extern void writeMappedPage(char *, PTE *);
+extern void syncMappings(int);
+extern int pageRange(void *, int, int *);
+extern int holdPage(PTE *);
+extern void releasePage(int);
+#endif
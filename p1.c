@@ -12,12 +12,22 @@
 #include "vm.h"
 #include "phase5utility.h"
 #include "providedPrototypes.h"
+#include "replacement.h"
+#include "loadControl.h"
+#include "swapCache.h"
+#include "swap.h"
+#include "sharing.h"
+#include "segments.h"
+#include "mapping.h"
+#include "prefetch.h"
+#include "pinning.h"
 
 extern int VMInitialized;
 extern int debugflag5;
 extern int NumPages;
 extern Frame *FrameTable;
 extern int NumFrames;
+extern int FramesMutex;
 
 /*
  *  The code that phase 1 should call when a new process is forked.
@@ -45,6 +55,23 @@ void p1_fork(int pid)
         USLOSS_Console("p1_fork(): Could not create private semaphore.\n");
         USLOSS_Halt(1);
     }
+    proc->virtualTime = 0;
+    proc->switchedIn = currentTime();
+    proc->deactivated = 0;
+    proc->held = FALSE;
+    proc->faults = 0;
+    proc->lastFault = 0;
+    proc->targetFrames = 1;
+    proc->minFrames = 0;
+    proc->maxFrames = NumFrames;
+    proc->wantPrefetch = FALSE;
+    proc->prefetching = 0;
+    proc->quitting = FALSE;
+    proc->unloaded = FALSE;
+    proc->blockedSince = EMPTY;
+    proc->idleSwapped = FALSE;
+    proc->pinnedPages = 0;
+    proc->pinsReserved = 0;
     initPageTable(pid);
 } /* p1_fork */
 
@@ -66,12 +93,14 @@ static void unloadMappings(const char *caller, int pid)
                 USLOSS_Console("%s(): Attempting to unmap page %d from frame %d for process %d\n", caller, i, pte->frame, pid);
             }
 
-            if (FrameTable[pte->frame].page != i)
+            // A shared frame or segment page is not owned by this process
+            int owned = !pte->cow && pte->segment == EMPTY;
+            if (owned && FrameTable[pte->frame].page != i)
             {
                 USLOSS_Console("%s(): Frame table has wrong page for frame %d.\n", caller, pte->frame);
                 USLOSS_Halt(1);
             }
-            if (FrameTable[pte->frame].pid != pid)
+            if (owned && FrameTable[pte->frame].pid != pid)
             {
                 USLOSS_Console("%s(): Frame table has wrong pid for frame %d.\n", caller, pte->frame);
                 USLOSS_Halt(1);
@@ -110,8 +139,34 @@ void p1_switch(int old, int new)
         USLOSS_Console("p1_switch() called: old = %d, new = %d\n", old, new);
     }
 
+    Process *oldProc = getProc(old);
     Process *newProc = getProc(new);
 
+    // Charge the old process for its time and sample its references
+    int now = currentTime();
+    if (oldProc->pid == old)
+    {
+        oldProc->virtualTime += now - oldProc->switchedIn;
+        sampleReferences(old);
+    }
+    newProc->switchedIn = now;
+    newProc->blockedSince = EMPTY;
+    newProc->idleSwapped = FALSE;
+
+    // The sentinel only runs when every other process is blocked
+    for (int i = 0; new == SENTINEL_PID && i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        if (proc->pid != EMPTY && proc->pid != SENTINEL_PID && proc->blockedSince == EMPTY)
+        {
+            proc->blockedSince = now;
+        }
+    }
+    if (newProc->pid == new && workingSetSwapped(new))
+    {
+        newProc->wantPrefetch = TRUE;
+    }
+
     if (DEBUG5 && debugflag5)
     {
         USLOSS_Console("p1_switch(): Initial mappings for process %d: \n", old);
@@ -121,8 +176,9 @@ void p1_switch(int old, int new)
     // Unload all of the mappings from the old process
     unloadMappings("p1_switch", old);
 
-    // Load all of the mappings for the new process
-    for (int i = 0; i < NumPages; i++)
+    // Load all of the mappings for the new process, unless it is giving
+    // back its memory as it quits
+    for (int i = 0; i < NumPages && !newProc->unloaded; i++)
     {
         PTE *current = &newProc->pageTable[i];
         // Load the mapping if the PTE indicates the page should be in memory
@@ -134,12 +190,13 @@ void p1_switch(int old, int new)
             }
 
             // Check the frame table for consistency
-            if (FrameTable[current->frame].page != i)
+            int owned = !current->cow && current->segment == EMPTY;
+            if (owned && FrameTable[current->frame].page != i)
             {
                 USLOSS_Console("p1_switch(): Frame table has invalid page for frame %d\n", current->frame);
                 USLOSS_Halt(1);
             }
-            if (FrameTable[current->frame].pid != new)
+            if (owned && FrameTable[current->frame].pid != new)
             {
                 USLOSS_Console("p1_switch(): Frame table has invalid pid for frame %d\n", current->frame);
                 USLOSS_Halt(1);
@@ -151,7 +208,9 @@ void p1_switch(int old, int new)
                 USLOSS_Halt(1);
             }
 
-            int result = USLOSS_MmuMap(TAG, i, current->frame, USLOSS_MMU_PROT_RW);
+            // Shared frames are mapped read-only so that a write faults
+            int protection = current->cow ? USLOSS_MMU_PROT_READ : USLOSS_MMU_PROT_RW;
+            int result = USLOSS_MmuMap(TAG, i, current->frame, protection);
             if (result != USLOSS_MMU_OK)
             {
                 USLOSS_Console("p1_switch(): Could not perform mapping. Error code %d.\n", result);
@@ -187,18 +246,55 @@ void p1_quit(int pid)
         USLOSS_Console("p1_quit() called: pid = %d\n", pid);
     }
 
-    // Unload our mappings
+    // A process that terminated gave its memory back before phase 1 woke
+    // its parent. Anything else must do it here.
+    if (!getProc(pid)->unloaded)
+    {
+        releaseProcess(pid);
+    }
+} /* p1_quit */
+
+/*
+ *  Give back the memory of the process with the given pid as it quits.
+ *  Must be called by the process itself. This may block, which is only
+ *  safe before phase 1 has quit the process and woken its parent, so
+ *  Terminate calls it first.
+ */
+void releaseProcess(int pid)
+{
+    // A parent in VmSpawn clones into us while holding the frames mutex
+    lockMutex(FramesMutex);
+    unlockMutex(FramesMutex);
+
+    // Let prefetches of our pages finish, then write our mapped disk
+    // regions back and unload our mappings for good
+    waitPrefetch(pid);
+    syncMappings(pid);
     unloadMappings("p1_quit", pid);
+    getProc(pid)->unloaded = TRUE;
+    unpinAll(pid);
 
-    // Clear out our frames
+    // Leave the frames we share to the other sharers and detach our
+    // segments, then clear out our frames
+    dropSharedPages(pid);
+    detachSegments(pid);
     for (int i = 0; i < NumFrames; i++)
     {
         if (FrameTable[i].pid == pid)
         {
+            if (FrameTable[i].page != EMPTY)
+            {
+                getProc(pid)->pageTable[FrameTable[i].page].frame = EMPTY;
+            }
             FrameTable[i].pid = EMPTY;
             FrameTable[i].page = EMPTY;
+            setFrameList(i, EMPTY);
+            FrameTable[i].warm = FALSE;
+            FrameTable[i].sharers = 0;
         }
     }
+    forgetProcess(pid);
+    cacheForget(pid);
 
     // Clean up the proc table entry for this process.
     Process *processPtr = getProc(pid);
@@ -208,11 +304,16 @@ void p1_quit(int pid)
         return;
     }
     processPtr->pid = EMPTY;
+    loadControlQuit(pid);
+    for (int i = 0; i < NumPages; i++)
+    {
+        swapFree(&processPtr->pageTable[i]);
+    }
     int result = semfreeReal(processPtr->privateSem);
     if (result != 0)
     {
-        USLOSS_Console("p1_quit(): Error in freeing private semaphore.\n");
+        USLOSS_Console("releaseProcess(): Error in freeing private semaphore.\n");
         USLOSS_Halt(1);
     }
     initPageTable(pid);
-} /* p1_quit */
+} /* releaseProcess */
@@ -0,0 +1,345 @@
+/*
+ *  File:  pagerPool.c
+ *
+ *  Description:  This file contains the adaptive pager pool, which adds
+ *                pagers while faults back up and retires them once the
+ *                backlog has cleared
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "pagerPool.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int FaultsMbox;
+
+/*
+ * The pool manager is the parent of every pager in the pool, so it can
+ * join the ones that retire. A fault that finds fewer idle pagers than
+ * queued faults wakes it to fork another pager. A pager retires itself
+ * when it finds no faults queued and the pool has not grown for
+ * POOL_IDLE microseconds. The timer wakes the manager on every clock
+ * interrupt while the pool is above its minimum, so the manager can retire
+ * a pager that is waiting for a fault that never comes.
+ */
+static int ManagerPID = EMPTY;
+static int TimerPID = EMPTY;
+static int TimerDoneSem;    // Signalled when the timer has stopped
+static int (*PagerFunc)(char *);
+static int PoolMutex;
+static int PoolSem;         // Wakes the manager
+static int PoolDoneSem;     // Signalled when the manager has stopped
+static int PoolQuit;
+static int PoolMin;         // Number of pagers the pool never drops below
+static int PoolSize;        // Number of pagers that are not retiring
+static int Retiring;        // Number of retired pagers not yet joined
+static int IdlePagers;      // Number of pagers waiting for a fault
+static int PendingFaults;   // Number of faults queued for the pagers
+static int GrowPending;     // Whether the manager has been asked to grow
+static int LastGrow;        // Time the pool last grew
+
+static int PoolManager(char *);
+static int PoolTimer(char *);
+static int takeRetiree();
+static void forkPager();
+
+/*
+ *  Start the pool manager with the given number of pagers, if MaxPagers
+ *  allows the pool to grow beyond that. Returns FALSE if the pool is fixed
+ *  and the caller should fork the pagers itself.
+ */
+int initPagerPool(int pagers, int (*pager)(char *))
+{
+    ManagerPID = EMPTY;
+    if (MaxPagers <= pagers)
+    {
+        return FALSE;
+    }
+    PagerFunc = pager;
+    PoolMutex = createMutex();
+    PoolSem = semcreateReal(0);
+    PoolDoneSem = semcreateReal(0);
+    TimerDoneSem = semcreateReal(0);
+    PoolQuit = FALSE;
+    PoolMin = pagers;
+    PoolSize = 0;
+    Retiring = 0;
+    IdlePagers = 0;
+    PendingFaults = 0;
+    GrowPending = FALSE;
+    LastGrow = currentTime();
+    ManagerPID = fork1("PoolManager", PoolManager, NULL, USLOSS_MIN_STACK, 2);
+    if (ManagerPID < 0)
+    {
+        USLOSS_Console("initPagerPool(): Can't create the pool manager.\n");
+        USLOSS_Halt(1);
+    }
+    TimerPID = fork1("PoolTimer", PoolTimer, NULL, USLOSS_MIN_STACK, 2);
+    if (TimerPID < 0)
+    {
+        USLOSS_Console("initPagerPool(): Can't create the pool timer.\n");
+        USLOSS_Halt(1);
+    }
+    return TRUE;
+}
+
+/*
+ *  Stop every pager in the pool, then the manager
+ */
+void stopPagerPool()
+{
+    if (ManagerPID == EMPTY)
+    {
+        return;
+    }
+    lockMutex(PoolMutex);
+    PoolQuit = TRUE;
+    unlockMutex(PoolMutex);
+    semvReal(PoolSem);
+    sempReal(PoolDoneSem);
+    sempReal(TimerDoneSem);
+    semfreeReal(PoolSem);
+    semfreeReal(PoolDoneSem);
+    semfreeReal(TimerDoneSem);
+    ManagerPID = EMPTY;
+    TimerPID = EMPTY;
+}
+
+/*
+ *  Called by a faulting process before it queues its fault. Wakes the
+ *  manager to add a pager if the queued faults outnumber the idle pagers.
+ */
+void poolFaultQueued()
+{
+    if (ManagerPID == EMPTY)
+    {
+        return;
+    }
+    lockMutex(PoolMutex);
+    PendingFaults++;
+    int grow = PendingFaults > IdlePagers && PoolSize < MaxPagers && !GrowPending;
+    if (grow)
+    {
+        GrowPending = TRUE;
+    }
+    unlockMutex(PoolMutex);
+    if (grow)
+    {
+        semvReal(PoolSem);
+    }
+}
+
+/*
+ *  Called by a pager before it waits for a fault
+ */
+void poolWaiting()
+{
+    if (ManagerPID == EMPTY)
+    {
+        return;
+    }
+    lockMutex(PoolMutex);
+    IdlePagers++;
+    unlockMutex(PoolMutex);
+}
+
+/*
+ *  Called by a pager when it has taken the fault of the given pid off the
+ *  queue, or a kill or retire code
+ */
+void poolTook(int pid)
+{
+    if (ManagerPID == EMPTY)
+    {
+        return;
+    }
+    lockMutex(PoolMutex);
+    IdlePagers--;
+    if (pid >= 0)
+    {
+        PendingFaults--;
+    }
+    unlockMutex(PoolMutex);
+}
+
+/*
+ *  Called by a pager between faults. Returns TRUE if the pager should
+ *  retire, in which case it has been taken out of the pool.
+ */
+int poolShouldRetire()
+{
+    if (ManagerPID == EMPTY)
+    {
+        return FALSE;
+    }
+    return takeRetiree();
+}
+
+/*
+ *  Called by a pager in the pool as it quits, so the manager joins it
+ */
+void poolPagerDone()
+{
+    semvReal(PoolSem);
+}
+
+/*
+ *  Kernel process that forks the pagers of the pool and joins the ones
+ *  that retire
+ */
+static int PoolManager(char *arg)
+{
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("PoolManager(): called.\n");
+    }
+    for (int i = 0; i < PoolMin; i++)
+    {
+        forkPager();
+    }
+
+    int status;
+    while (TRUE)
+    {
+        sempReal(PoolSem);
+        lockMutex(PoolMutex);
+        if (PoolQuit)
+        {
+            unlockMutex(PoolMutex);
+            break;
+        }
+        int grow = GrowPending && PoolSize < MaxPagers;
+        GrowPending = FALSE;
+        int retired = Retiring;
+        Retiring = 0;
+        int idle = IdlePagers > 0;
+        unlockMutex(PoolMutex);
+
+        for (int i = 0; i < retired; i++)
+        {
+            join(&status);
+        }
+        if (grow)
+        {
+            forkPager();
+        }
+        else if (idle && takeRetiree())
+        {
+            // An idle pager never checks whether to retire, so tell one to
+            int retire = POOL_RETIRE;
+            MboxSend(FaultsMbox, &retire, sizeof(int));
+        }
+    }
+
+    // Kill the pagers that are left and wait for all of them
+    lockMutex(PoolMutex);
+    int live = PoolSize;
+    int quitting = PoolSize + Retiring;
+    unlockMutex(PoolMutex);
+    for (int i = 0; i < live; i++)
+    {
+        int kill = -1;
+        MboxSend(FaultsMbox, &kill, sizeof(int));
+    }
+    for (int i = 0; i < quitting; i++)
+    {
+        join(&status);
+    }
+    semvReal(PoolDoneSem);
+    return 0;
+}
+
+/*
+ *  Kernel process that wakes the manager on every clock interrupt while
+ *  the pool has pagers it could retire
+ */
+static int PoolTimer(char *arg)
+{
+    while (TRUE)
+    {
+        int status;
+        waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+        lockMutex(PoolMutex);
+        int quit = PoolQuit;
+        int extra = PoolSize > PoolMin;
+        unlockMutex(PoolMutex);
+        if (quit)
+        {
+            break;
+        }
+        if (extra)
+        {
+            semvReal(PoolSem);
+        }
+    }
+    semvReal(TimerDoneSem);
+    return 0;
+}
+
+/*
+ *  Take a pager out of the pool if no faults are queued and the pool has
+ *  not grown for POOL_IDLE microseconds. Returns TRUE if the caller should
+ *  retire a pager.
+ */
+static int takeRetiree()
+{
+    lockMutex(PoolMutex);
+    int retire = !PoolQuit && PendingFaults == 0 && PoolSize > PoolMin &&
+            currentTime() - LastGrow > POOL_IDLE;
+    if (retire)
+    {
+        PoolSize--;
+        Retiring++;
+        LastGrow = currentTime();
+    }
+    unlockMutex(PoolMutex);
+
+    if (retire)
+    {
+        lockMutex(vmStatsMutex);
+        vmStats.pagerRetires++;
+        unlockMutex(vmStatsMutex);
+    }
+    return retire;
+}
+
+/*
+ *  Fork another pager into the pool
+ */
+static void forkPager()
+{
+    int pid = fork1("Pager", PagerFunc, NULL, USLOSS_MIN_STACK, 2);
+    if (pid < 0)
+    {
+        USLOSS_Console("forkPager(): Can't create a pager.\n");
+        USLOSS_Halt(1);
+    }
+
+    lockMutex(PoolMutex);
+    PoolSize++;
+    LastGrow = currentTime();
+    int size = PoolSize;
+    unlockMutex(PoolMutex);
+
+    lockMutex(vmStatsMutex);
+    if (size > vmStats.peakPagers)
+    {
+        vmStats.peakPagers = size;
+    }
+    unlockMutex(vmStatsMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("forkPager(): Pool now has %d pagers.\n", size);
+    }
+}
@@ -0,0 +1,15 @@
+/*
+ * pagerPool.h
+ */
+
+#ifndef _PAGERPOOL_H
+#define _PAGERPOOL_H
+
+extern int initPagerPool(int, int (*)(char *));
+extern void stopPagerPool();
+extern void poolFaultQueued();
+extern void poolWaiting();
+extern void poolTook(int);
+extern int poolShouldRetire();
+extern void poolPagerDone();
+#endif
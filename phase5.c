@@ -20,10 +20,73 @@
 #include "syscallHandlers.h"
 #include "phase5utility.h"
 #include "providedPrototypes.h"
+#include "replacement.h"
+#include "loadControl.h"
+#include "swapCache.h"
+#include "swap.h"
+#include "sharing.h"
+#include "segments.h"
+#include "mapping.h"
+#include "pagerPool.h"
+#include "prefetch.h"
+#include "swapper.h"
+#include "pinning.h"
 
 // Debugging flag
 int debugflag5 = 0;
 
+// Extended statistics flag
+int statsflag5 = 0;
+
+// Page replacement policy
+int ReplacementPolicy = POLICY_CLOCK;
+int WorkingSetWindow = 100000;
+
+// Frame allocation policy
+int FrameAllocation = ALLOC_GLOBAL;
+
+// Load control
+int LoadControl = FALSE;
+
+// Compressed swap cache
+int SwapCacheSize = 0;
+
+// Compressed swap format
+int CompressedSwap = FALSE;
+
+// The number of disks the swap space is striped across
+int SwapDisks = 1;
+
+// Whether swap I/O is scheduled in elevator order
+int SwapScheduler = FALSE;
+
+// Whether the swap space is laid out as a log
+int LogSwap = FALSE;
+
+// Whether each process's swap space is clustered in extents
+int SwapExtents = FALSE;
+
+// The number of pager workers
+int PagerWorkers = 0;
+
+// The most pagers the pager pool may grow to, 0 for a fixed pool
+int MaxPagers = 0;
+
+// Zero-page elision
+int ZeroPageElision = FALSE;
+
+// Shared zero frame
+int SharedZeroFrame = FALSE;
+
+// Same-page merging
+int PageMerging = FALSE;
+
+// Working set prefetch on switch-in
+int SwitchPrefetch = FALSE;
+
+// Idle process swap-out
+int IdleSwapTime = 0;
+
 // Process info
 Process ProcTable[MAXPROC];
 
@@ -43,7 +106,14 @@ int NumPagers;
 int PagerPIDs[MAXPAGERS];
 int FaultsMbox;
 int PagerKillSem;
-int NextBlock = 0;
+
+// Whether the pagers belong to the adaptive pool
+int PoolPagers = FALSE;
+
+// Pager worker info
+int NumWorkers = 0;
+int WorkerPIDs[MAXWORKERS];
+int JobsMbox;
 
 // Start of the Vm Region
 void *vmRegion;
@@ -58,8 +128,22 @@ int VMInitialized = FALSE;
 int NumPages = 0;
 int NumFrames = 0;
 
+// The frame kept full of zeros for untouched pages, EMPTY if none
+int ZeroFrame = EMPTY;
+
 static void FaultHandler(int, void *);
 static int Pager(char *);
+static int PagerWorker(char *);
+static void completeFault(PageJob *);
+static int evictFrame(int);
+static int isZeroPage(char *);
+static void initZeroFrame();
+static void readFrame(char *, int, int);
+static void loadPage(int, int, int);
+static int ownedFrame(Process *, int);
+static int clusterFrame(Process *, int);
+static int writeCluster(int, int, int *, int);
+static void printProcessStats();
 
 extern int start5(char *);
 
@@ -93,9 +177,26 @@ int start4(char *arg)
     systemCallVec[SYS_MBOXCONDSEND]    = mbox_condsend;
     systemCallVec[SYS_MBOXCONDRECEIVE] = mbox_condreceive;
 
+    /* a process gives back its memory before phase 3 terminates it */
+    terminateHandler = systemCallVec[SYS_TERMINATE];
+    systemCallVec[SYS_TERMINATE] = vmTerminate;
+
     /* user-process access to VM functions */
     systemCallVec[SYS_VMINIT]    = vmInit;
     systemCallVec[SYS_VMDESTROY] = vmDestroy;
+    systemCallVec[SYS_VMLIMIT]   = vmLimit;
+    systemCallVec[SYS_VMSHMCREATE] = vmShmCreate;
+    systemCallVec[SYS_VMSHMATTACH] = vmShmAttach;
+    systemCallVec[SYS_VMSHMDETACH] = vmShmDetach;
+    systemCallVec[SYS_VMSPAWN]     = vmSpawn;
+    systemCallVec[SYS_VMMAP]       = vmMap;
+    systemCallVec[SYS_VMSYNC]      = vmSync;
+    systemCallVec[SYS_VMUNMAP]     = vmUnmap;
+    systemCallVec[SYS_VMADVISE]    = vmAdvise;
+    systemCallVec[SYS_VMLOCK]      = vmLock;
+    systemCallVec[SYS_VMUNLOCK]    = vmUnlock;
+    systemCallVec[SYS_VMPOPULATE]  = vmPopulate;
+    systemCallVec[SYS_VMRESIDENT]  = vmResident;
 
     int pid;
     int result = Spawn("Start5", start5, NULL, 8 * USLOSS_MIN_STACK, 2, &pid);
@@ -150,7 +251,12 @@ void *vmInitReal(int mappings, int pages, int frames, int pagers)
     {
         return (void *) -1;
     }
-    if (pagers > MAXPAGERS)
+    if (pagers > MAXPAGERS || PagerWorkers < 0 || PagerWorkers > MAXWORKERS ||
+            MaxPagers > MAXPOOL)
+    {
+        return (void *) -1;
+    }
+    if (SwapDisks < 1 || SwapDisks > USLOSS_DISK_UNITS)
     {
         return (void *) -1;
     }
@@ -159,6 +265,7 @@ void *vmInitReal(int mappings, int pages, int frames, int pagers)
     for (int i = 0; i < MAXPROC; i++)
     {
         getProc(i)->pid = EMPTY;
+        getProc(i)->unloaded = FALSE;
     }
 
     // Init the Mmu
@@ -192,8 +299,20 @@ void *vmInitReal(int mappings, int pages, int frames, int pagers)
         FrameTable[i].page = EMPTY;
         FrameTable[i].pid = EMPTY;
         FrameTable[i].locked = FALSE;
+        FrameTable[i].list = EMPTY;
+        FrameTable[i].warm = FALSE;
+        FrameTable[i].sharers = 0;
     }
     FramesMutex = createMutex();
+    initZeroFrame();
+    initSharing();
+    initSegments();
+    initMappings();
+    initPinning();
+    initReplacement(frames);
+    initLoadControl();
+    initPrefetch();
+    initSwapper();
 
     // Create the fault mailbox.
     FaultsMbox = MboxCreate(MAXPROC, MAX_MESSAGE);
@@ -202,11 +321,17 @@ void *vmInitReal(int mappings, int pages, int frames, int pagers)
         USLOSS_Console("vmInitReal(): FaultsMbox created as %d\n", FaultsMbox);
     }
 
+    // Zero out, then initialize, the vmStats structure. The pool manager
+    // keeps statistics as soon as it runs.
+    initVmStats(&vmStats, pages, frames);
+
     /*
-     * Fork the pagers.
+     * Fork the pagers, or have the pool manager fork them if the pool
+     * may grow.
      */
-    NumPagers = pagers;
-    for (int i = 0; i < pagers; i++)
+    PoolPagers = initPagerPool(pagers, Pager);
+    NumPagers = PoolPagers ? 0 : pagers;
+    for (int i = 0; i < NumPagers; i++)
     {
         PagerPIDs[i] = fork1("Pager", Pager, NULL, USLOSS_MIN_STACK, 2);
         if(PagerPIDs[i] < 0)
@@ -215,13 +340,26 @@ void *vmInitReal(int mappings, int pages, int frames, int pagers)
           USLOSS_Halt(1);
         }
     }
-    for (int i = pagers; i < MAXPAGERS; i++)
+    for (int i = NumPagers; i < MAXPAGERS; i++)
     {
         PagerPIDs[i] = -1;
     }
 
-    // Zero out, then initialize, the vmStats structure
-    initVmStats(&vmStats, pages, frames);
+    // Fork the pager workers, which take jobs from the pagers
+    NumWorkers = PagerWorkers;
+    JobsMbox = NumWorkers > 0 ? MboxCreate(MAXPROC, sizeof(PageJob)) : -1;
+    for (int i = 0; i < NumWorkers; i++)
+    {
+        WorkerPIDs[i] = fork1("PagerWorker", PagerWorker, NULL, USLOSS_MIN_STACK, 2);
+        if (WorkerPIDs[i] < 0)
+        {
+            USLOSS_Console("vmInitReal(): Can't create pager worker %d\n", i);
+            USLOSS_Halt(1);
+        }
+    }
+
+    initSwap();
+    initSwapCache();
 
     VMInitialized = TRUE;
     int dummy;
@@ -258,14 +396,318 @@ void PrintStats(void)
     USLOSS_Console("pageIns:        %d\n", vmStats.pageIns);
     USLOSS_Console("pageOuts:       %d\n", vmStats.pageOuts);
     USLOSS_Console("replaced:       %d\n", vmStats.replaced);
+    if (statsflag5)
+    {
+        USLOSS_Console("policy:         %s\n",
+                ReplacementPolicy == POLICY_CAR ? "car" :
+                ReplacementPolicy == POLICY_WSCLOCK ? "wsclock" : "clock");
+        USLOSS_Console("refaults:       %d\n", vmStats.refaults);
+        USLOSS_Console("ghostHits:      %d\n", vmStats.ghostHits);
+
+        // A fault that does not bring back a replaced page is one that no
+        // replacement policy could have avoided. The policies are compared
+        // by their refaults, and CAR by how many of them its ghosts saw.
+        int compulsoryFaultPct = vmStats.faults > 0 ?
+                (vmStats.faults - vmStats.refaults) * 100 / vmStats.faults : 0;
+        int refaultPct = vmStats.faults > 0 ? vmStats.refaults * 100 / vmStats.faults : 0;
+        USLOSS_Console("compulsoryPct:  %d\n", compulsoryFaultPct);
+        USLOSS_Console("refaultPct:     %d\n", refaultPct);
+        USLOSS_Console("deactivations:  %d\n", vmStats.deactivations);
+        USLOSS_Console("reactivations:  %d\n", vmStats.reactivations);
+        if (FrameAllocation == ALLOC_PFF)
+        {
+            USLOSS_Console("targetGrows:    %d\n", vmStats.targetGrows);
+            USLOSS_Console("targetShrinks:  %d\n", vmStats.targetShrinks);
+        }
+        if (SwapCacheSize > 0)
+        {
+            int stored = vmStats.cacheStores * USLOSS_MmuPageSize();
+            int ratio = vmStats.cacheBytes > 0 ? stored * 100 / vmStats.cacheBytes : 0;
+            USLOSS_Console("cacheStores:    %d\n", vmStats.cacheStores);
+            USLOSS_Console("cacheHits:      %d\n", vmStats.cacheHits);
+            USLOSS_Console("cacheWritebacks:%d\n", vmStats.cacheWritebacks);
+            USLOSS_Console("cacheRatio:     %d.%02d\n", ratio / 100, ratio % 100);
+        }
+        USLOSS_Console("sectorsRead:    %d\n", vmStats.sectorsRead);
+        USLOSS_Console("sectorsWritten: %d\n", vmStats.sectorsWritten);
+        for (int i = 0; i < USLOSS_DISK_UNITS; i++)
+        {
+            if (isSwapUnit(i))
+            {
+                USLOSS_Console("disk%dReads:     %d\n", i, vmStats.unitReads[i]);
+                USLOSS_Console("disk%dWrites:    %d\n", i, vmStats.unitWrites[i]);
+            }
+        }
+        int seek = vmStats.seeks > 0 ? vmStats.seekTracks * 100 / vmStats.seeks : 0;
+        USLOSS_Console("scheduler:      %s\n", SwapScheduler ? "cscan" : "fifo");
+        USLOSS_Console("avgSeek:        %d.%02d\n", seek / 100, seek % 100);
+        if (PagerWorkers > 0)
+        {
+            USLOSS_Console("workerJobs:     %d\n", vmStats.workerJobs);
+        }
+        if (PoolPagers)
+        {
+            USLOSS_Console("peakPagers:     %d\n", vmStats.peakPagers);
+            USLOSS_Console("pagerRetires:   %d\n", vmStats.pagerRetires);
+        }
+        if (SwapExtents)
+        {
+            USLOSS_Console("readAheadHits:  %d\n", vmStats.readAheadHits);
+        }
+        if (IdleSwapTime > 0)
+        {
+            USLOSS_Console("idleSwapOuts:   %d\n", vmStats.idleSwapOuts);
+            USLOSS_Console("idleFrames:     %d\n", vmStats.idleFrames);
+        }
+        if (LogSwap)
+        {
+            USLOSS_Console("segmentsCleaned:%d\n", vmStats.segmentsCleaned);
+            USLOSS_Console("runsMoved:      %d\n", vmStats.runsMoved);
+        }
+        if (ZeroPageElision)
+        {
+            USLOSS_Console("zeroElided:     %d\n", vmStats.zeroPagesElided);
+        }
+        if (SharedZeroFrame)
+        {
+            USLOSS_Console("zeroFrameMaps:  %d\n", vmStats.zeroFrameMaps);
+        }
+        USLOSS_Console("cowFaults:      %d\n", vmStats.cowFaults);
+        USLOSS_Console("mappedReads:    %d\n", vmStats.mappedReads);
+        USLOSS_Console("mappedWrites:   %d\n", vmStats.mappedWrites);
+        USLOSS_Console("advisedFetches: %d\n", vmStats.advisedFetches);
+        USLOSS_Console("advisedDrops:   %d\n", vmStats.advisedDrops);
+        USLOSS_Console("pinnedPages:    %d\n", vmStats.pinnedPages);
+        USLOSS_Console("pinFaults:      %d\n", vmStats.pinFaults);
+        USLOSS_Console("prefetched:     %d\n", vmStats.prefetched);
+        USLOSS_Console("populated:      %d\n", vmStats.populated);
+        if (PageMerging)
+        {
+            USLOSS_Console("pagesMerged:    %d\n", vmStats.pagesMerged);
+            USLOSS_Console("framesSaved:    %d\n", vmStats.framesSaved);
+        }
+    }
     unlockMutex(vmStatsMutex);
 
+    if (statsflag5)
+    {
+        printProcessStats();
+    }
+
     if (DEBUG5 && debugflag5)
     {
         dumpProcesses();
     }
 } /* PrintStats */
 
+/*
+ *  Print the memory use of every process using the VM system
+ */
+static void printProcessStats()
+{
+    lockMutex(FramesMutex);
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        if (proc->pid == EMPTY)
+        {
+            continue;
+        }
+        int resident = 0;
+        for (int j = 0; j < NumFrames; j++)
+        {
+            if (FrameTable[j].pid == proc->pid)
+            {
+                resident++;
+            }
+        }
+        USLOSS_Console("proc %d: faults %d, resident %d (min %d, max %d), target %d, workingSet %d\n",
+                proc->pid, proc->faults, resident, proc->minFrames, proc->maxFrames,
+                proc->targetFrames, workingSetSize(proc->pid));
+    }
+    unlockMutex(FramesMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmLimitReal --
+ *
+ * Called by vmLimit.
+ * Sets the number of frames reserved for a process and the most
+ * frames it may hold. The reservations of all processes together
+ * must leave at least one frame unreserved.
+ *
+ * Results:
+ *      0 on success, -1 if the arguments are invalid.
+ *
+ * Side effects:
+ *      Victim selection honours the new limits from the next fault on.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmLimitReal(int pid, int minFrames, int maxFrames)
+{
+    CheckMode();
+
+    if (!VMInitialized || pid < 0)
+    {
+        return -1;
+    }
+    Process *proc = getProc(pid);
+    if (proc->pid != pid)
+    {
+        return -1;
+    }
+    if (maxFrames == -1)
+    {
+        maxFrames = NumFrames;
+    }
+    if (minFrames < 0 || maxFrames < 1 || maxFrames > NumFrames || minFrames > maxFrames)
+    {
+        return -1;
+    }
+
+    lockMutex(FramesMutex);
+    int reserved = minFrames;
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *other = getProc(i);
+        if (other->pid != EMPTY && other != proc)
+        {
+            reserved += other->minFrames;
+        }
+    }
+    if (reserved >= NumFrames)
+    {
+        unlockMutex(FramesMutex);
+        return -1;
+    }
+    proc->minFrames = minFrames;
+    proc->maxFrames = maxFrames;
+    unlockMutex(FramesMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmLimitReal(): pid %d limited to %d-%d frames.\n", pid, minFrames, maxFrames);
+    }
+    return 0;
+} /* vmLimitReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmResidentReal --
+ *
+ * Called by vmResident.
+ * Reports the state of each page in the given range of the current
+ * process's VM region in one byte of the given vector, as a set of
+ * VM_RES_ bits. The pages are not touched, so nothing faults. The vector
+ * must lie outside the VM region.
+ *
+ * Results:
+ *      0 on success, -1 if the arguments are invalid.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmResidentReal(void *addr, int pages, char *vec)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || vec == NULL || !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    int dummy;
+    char *region = USLOSS_MmuRegion(&dummy);
+    if (vec + pages > region && vec < region + NumPages * USLOSS_MmuPageSize())
+    {
+        return -1;
+    }
+
+    Process *proc = getProc(getpid());
+    char state[pages];
+    lockMutex(FramesMutex);
+    for (int i = 0; i < pages; i++)
+    {
+        PTE *pte = &proc->pageTable[start + i];
+        PTE *home = homePTE(pte);
+        state[i] = 0;
+        if (pte->state == INMEM && pte->frame != EMPTY)
+        {
+            state[i] |= VM_RES_INMEM;
+            if (pte->frame != ZeroFrame && (getFrameAccess(pte->frame) & USLOSS_MMU_DIRTY))
+            {
+                state[i] |= VM_RES_DIRTY;
+            }
+        }
+        if (home->diskBlock != EMPTY || home->mapUnit != EMPTY)
+        {
+            state[i] |= VM_RES_ONDISK;
+        }
+        if (pte->pinned)
+        {
+            state[i] |= VM_RES_PINNED;
+        }
+    }
+    unlockMutex(FramesMutex);
+    memcpy(vec, state, pages);
+    return 0;
+} /* vmResidentReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmSpawnReal --
+ *
+ * Called by vmSpawn.
+ * Spawns a child that starts with a copy-on-write clone of the current
+ * process's VM region.
+ *
+ * Results:
+ *      The pid of the child, or -1 if it could not be spawned.
+ *
+ * Side effects:
+ *      The current process's resident pages become read-only until it
+ *      writes them.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmSpawnReal(char *name, int (*func)(char *), char *arg, int stackSize, int priority)
+{
+    CheckMode();
+
+    if (!VMInitialized)
+    {
+        return -1;
+    }
+
+    int pid = getpid();
+    lockMutex(FramesMutex);
+    if (!prepareClone(pid))
+    {
+        unlockMutex(FramesMutex);
+        return -1;
+    }
+
+    /*
+     * The child has no pages yet, so it faults on its first access to the
+     * VM region. Its fault, or its quit, waits for the frames mutex, so
+     * the child never sees its address space before the clone is done.
+     */
+    int child = spawnReal(name, func, arg, stackSize, priority);
+    if (child >= 0)
+    {
+        cloneAddressSpace(pid, child);
+    }
+    unlockMutex(FramesMutex);
+    return child < 0 ? -1 : child;
+} /* vmSpawnReal */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -290,6 +732,11 @@ void vmDestroyReal()
     }
 
     CheckMode();
+    stopSharing();
+    stopCleaner();
+    stopPrefetch();
+    stopSwapper();
+    stopLoadControl();
     int result = USLOSS_MmuDone();
 
     /*
@@ -302,6 +749,19 @@ void vmDestroyReal()
         MboxSend(FaultsMbox, &kill, sizeof(int));
         sempReal(PagerKillSem);
     }
+    stopPagerPool();
+    for (int i = 0; i < NumWorkers; i++)
+    {
+        PageJob kill;
+        kill.pid = -1;
+        MboxSend(JobsMbox, &kill, sizeof(PageJob));
+        sempReal(PagerKillSem);
+    }
+    if (NumWorkers > 0)
+    {
+        MboxRelease(JobsMbox);
+    }
+    NumWorkers = 0;
 
     if (result != USLOSS_MMU_OK)
     {
@@ -320,6 +780,10 @@ void vmDestroyReal()
         free(proc->pageTable);
     }
     free(FrameTable);
+    destroyReplacement();
+    destroySwapCache();
+    destroySegments();
+    destroySwap();
 
 } /* vmDestroyReal */
 
@@ -342,17 +806,39 @@ void vmDestroyReal()
  */
 static void FaultHandler(int type, void* offset)
 {
-    int pid = getpid();
-
     if (DEBUG5 && debugflag5)
     {
-        USLOSS_Console("FaultHandler(%d): called.\n", pid);
+        USLOSS_Console("FaultHandler(%d): called.\n", getpid());
     }
 
     assert(type == USLOSS_MMU_INT);
     int cause = USLOSS_MmuGetCause();
-    assert(cause == USLOSS_MMU_FAULT);
-    
+    assert(cause == USLOSS_MMU_FAULT || cause == USLOSS_MMU_ACCESS);
+    faultIn(offset, cause);
+} /* FaultHandler */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * faultIn
+ *
+ * Hands a fault with the given cause at the given offset into the VM
+ * region of the current process to the pagers, and blocks until it has
+ * been handled. Called by FaultHandler, and by VmLock to bring in the
+ * pages it pins.
+ *
+ * Results:
+ * None.
+ *
+ * Side effects:
+ * The current process is blocked until the fault is handled.
+ *
+ *----------------------------------------------------------------------
+ */
+void faultIn(void *offset, int cause)
+{
+    int pid = getpid();
+
     // Update vmStats
     lockMutex(vmStatsMutex);
     vmStats.faults++;
@@ -361,50 +847,56 @@ static void FaultHandler(int type, void* offset)
     int failure = TRUE;
     while (failure)
     {
+        // Hold off here while load control has the process deactivated
+        waitIfDeactivated(pid);
+
         // Fill in the fault message
         FaultMsg *faultMsg = faults + (getpid() % MAXPROC);
         faultMsg->addr = offset;
         faultMsg->pid = pid;
+        faultMsg->cause = cause;
         faultMsg->failed = FALSE;
         faultMsg->shouldTerminate = FALSE;
 
         // Send to pager
         if (DEBUG5 && debugflag5)
         {
-            USLOSS_Console("FaultHandler(%d): Sending fault for address %p.\n", pid, offset);
+            USLOSS_Console("faultIn(%d): Sending fault for address %p.\n", pid, offset);
         }
+        poolFaultQueued();
         int result = MboxSend(FaultsMbox, &pid, sizeof(int));
         if (result != 0)
         {
-            USLOSS_Console("FaultHandler(%d): MboxSend failed.\n", pid);
+            USLOSS_Console("faultIn(%d): MboxSend failed.\n", pid);
         }
 
         if (DEBUG5 && debugflag5)
         {
-            USLOSS_Console("FaultHandler(%d): Waiting for Pager.\n", pid);
+            USLOSS_Console("faultIn(%d): Waiting for Pager.\n", pid);
         }
 
         // Wait for reply
         semPProc();
         if (DEBUG5 && debugflag5)
         {
-            USLOSS_Console("FaultHandler(%d): Returned from page fault.\n", pid);
+            USLOSS_Console("faultIn(%d): Returned from page fault.\n", pid);
         }
 
         if (faultMsg->shouldTerminate)
         {
+            releaseProcess(pid);
             terminateReal(1);
         }
 
         failure = faultMsg->failed;
-        if (!failure)
+        if (!failure && faultMsg->receivedFrame != EMPTY)
         {
             lockMutex(FramesMutex);
             FrameTable[faultMsg->receivedFrame].locked = FALSE;
             unlockMutex(FramesMutex);
         }
     }
-} /* FaultHandler */
+} /* faultIn */
 
 /*
  *----------------------------------------------------------------------
@@ -429,26 +921,30 @@ static int Pager(char *arg)
     }
     while (TRUE)
     {
-        // Kill pager if we are zapped
-        if (isZapped())
+        // Kill pager if we are zapped, or retire it from the pool if the
+        // pool has more pagers than it needs
+        if (isZapped() || poolShouldRetire())
         {
             break;
         }
 
         // Wait for fault to occur (receive from mailbox)
         int pid;
+        poolWaiting();
         int result = MboxReceive(FaultsMbox, &pid, sizeof(int));
         if (result < 0)
         {
             USLOSS_Console("Pager(): MboxReceive failed with error code %d.\n", result);
             break;
         }
+        poolTook(pid);
 
-        // Kill the pager if we got the killcode
+        // Kill the pager if we got the killcode, or retire it
         if (pid < 0)
         {
             break;
         }
+        int faultStart = currentTime();
 
         // Get the fault info from the array
         FaultMsg *fault = &faults[pid];
@@ -458,145 +954,1019 @@ static int Pager(char *arg)
             USLOSS_Console("Pager(): Fault for address %p, page number %d.\n", fault->addr, incomingPage);
         }
 
-        // Check if incoming page is new
+        // Check if incoming page is new. A page of a shared segment is
+        // kept by the segment.
         Process *proc = getProc(pid);
-        int incomingPageExists = proc->pageTable[incomingPage].state != UNUSED;
+        PTE *home = homePTE(&proc->pageTable[incomingPage]);
+        int attached = proc->pageTable[incomingPage].segment != EMPTY;
+        int mapped = home->mapUnit != EMPTY;
+        int incomingPageExists = home->state != UNUSED;
+        int incomingPageReplaced = home->state == ONDISK;
 
-        // Find the frame to replace
-        lockMutex(FramesMutex);
-        int frame = getNextFrame();
-        unlockMutex(FramesMutex);
-        if (frame == EMPTY)
+        // A write to a shared read-only page needs a private copy of it.
+        // The sharing may have ended while the write waited for a pager.
+        int copyOnWrite = proc->pageTable[incomingPage].state == INMEM &&
+                proc->pageTable[incomingPage].cow;
+        int sharedFrame = proc->pageTable[incomingPage].frame;
+        if (fault->cause == USLOSS_MMU_ACCESS && !copyOnWrite &&
+                proc->pageTable[incomingPage].state == INMEM)
         {
-            fault->failed = TRUE;
+            fault->receivedFrame = EMPTY;
             semVProc(pid);
             continue;
         }
-        fault->receivedFrame = frame;
-        int outgoingPage = FrameTable[frame].page;
-        Process *outgoingPageProc = getProc(FrameTable[frame].pid);
 
-        // Update vmStats
-        if (!incomingPageExists)
+        // Map an untouched page to the zero frame until it is written
+        if (!incomingPageExists && ZeroFrame != EMPTY && !attached)
         {
+            proc->pageTable[incomingPage].state = INMEM;
+            proc->pageTable[incomingPage].frame = ZeroFrame;
+            proc->pageTable[incomingPage].cow = TRUE;
+            fault->receivedFrame = EMPTY;
+
             lockMutex(vmStatsMutex);
             vmStats.new++;
+            vmStats.zeroFrameMaps++;
             unlockMutex(vmStatsMutex);
+
+            if (DEBUG5 && debugflag5)
+            {
+                USLOSS_Console("Pager(): Mapped page %d of pid %d to the zero frame.\n", incomingPage, pid);
+            }
+            semVProc(pid);
+            continue;
         }
 
-        // Update the tables
-        if (outgoingPage != EMPTY)
+        // Find the frame to replace. A shared frame being copied is locked
+        // first so that it is not replaced meanwhile. A segment page that
+        // another process has loaded only needs mapping.
+        int holdShared = copyOnWrite && sharedFrame != ZeroFrame;
+        lockMutex(FramesMutex);
+        int frame = EMPTY;
+        int mapOnly = FALSE;
+        PTE *own = &proc->pageTable[incomingPage];
+        if (own->loading)
         {
-            outgoingPageProc->pageTable[outgoingPage].state = ONDISK;
-            outgoingPageProc->pageTable[outgoingPage].frame = EMPTY;
+            // The page is moving to or from disk; the fault is retried
         }
-        FrameTable[frame].page = incomingPage;
-        FrameTable[frame].pid = pid;
-        FrameTable[frame].locked = TRUE;
-        proc->pageTable[incomingPage].state = INMEM;
-        proc->pageTable[incomingPage].frame = frame;
-
-        // Check the access bits
-        int access;
-        result = USLOSS_MmuGetAccess(frame, &access);
-        if (result != USLOSS_MMU_OK)
+        else if (!attached && !copyOnWrite && own->state == INMEM)
         {
-            USLOSS_Console("Pager(): Could not read frame access bits.\n");
-            USLOSS_Halt(1);
+            // A prefetch brought the page in while the fault waited
+            mapOnly = TRUE;
         }
-
-        // Write to disk if necessary
-        if (outgoingPage != EMPTY && (access & USLOSS_MMU_DIRTY))
+        else if (attached && home->frame != EMPTY)
         {
-            if (DEBUG5 && debugflag5)
+            mapOnly = !FrameTable[home->frame].locked;
+            if (mapOnly)
             {
-                USLOSS_Console("Pager(): Writing page %d to disk for pid %d.\n", outgoingPage, outgoingPageProc->pid);
+                segmentLoaded(&proc->pageTable[incomingPage], home->frame);
             }
-
-            // Get the appropriate disk block
-            int block = outgoingPageProc->pageTable[outgoingPage].diskBlock;
-            if (block == EMPTY)
+        }
+        else if (!holdShared || !FrameTable[sharedFrame].locked)
+        {
+            if (holdShared)
             {
-                if (NextBlock == vmStats.diskBlocks)
-                {
-                    USLOSS_Console("Pager(): Swap disk has run out of space.\n");
-                    fault->shouldTerminate = TRUE;
-                    semVProc(pid);
-                    continue;
-                }
-
-                // Find a new block
-                block = NextBlock++;
-                outgoingPageProc->pageTable[outgoingPage].diskBlock = block;
+                FrameTable[sharedFrame].locked = TRUE;
             }
-
-            // Read the buffer from the vmRegion and write to disk
-            char buffer[USLOSS_MmuPageSize()];
-            result = USLOSS_MmuMap(TAG, outgoingPage, frame, USLOSS_MMU_PROT_RW);
-            if (result != USLOSS_MMU_OK)
+            adjustTarget(pid);
+            frame = getNextFrame(pid);
+            if (frame != EMPTY)
             {
-                USLOSS_Console("Pager(): Could not perform mapping. Error code %d.\n", result);
-                USLOSS_Halt(1);
+                FrameTable[frame].locked = TRUE;
+                if (attached)
+                {
+                    // Other processes wait for the page while it loads
+                    home->frame = frame;
+                }
             }
-            memcpy(buffer, page(outgoingPage), USLOSS_MmuPageSize());
-            result = USLOSS_MmuUnmap(TAG, outgoingPage);
-            if (result != USLOSS_MMU_OK)
+            else if (holdShared)
             {
-                USLOSS_Console("Pager(): Could not perform unmapping. Error code %d.\n", result);
-                USLOSS_Halt(1);
+                FrameTable[sharedFrame].locked = FALSE;
             }
-            writePageToDisk(buffer, outgoingPageProc->pid, outgoingPage);
         }
-
-        // Initialize the buffer to match the incoming page
-        char buffer[USLOSS_MmuPageSize()];
-        if (incomingPageExists && proc->pageTable[incomingPage].diskBlock != EMPTY)
+        unlockMutex(FramesMutex);
+        if (mapOnly)
         {
-            if (DEBUG5 && debugflag5)
-            {
-                USLOSS_Console("Pager(): Reading page %d from disk for pid %d.\n", incomingPage, pid);
-            }
-            readPageFromDisk(buffer, pid, incomingPage);
+            fault->receivedFrame = EMPTY;
+            semVProc(pid);
+            continue;
         }
-        else
+        if (frame == EMPTY)
         {
-            for (int i = 0; i < USLOSS_MmuPageSize(); i++)
-            {
-                buffer[i] = 0;
-            }
+            fault->failed = TRUE;
+            semVProc(pid);
+            continue;
         }
 
-        // Write the buffer
-        result = USLOSS_MmuMap(TAG, incomingPage, frame, USLOSS_MMU_PROT_RW);
-        if (result != USLOSS_MMU_OK)
+        // Hand the rest of the fault to a worker if there are any, and
+        // go on to the next fault
+        PageJob job;
+        job.pid = pid;
+        job.incomingPage = incomingPage;
+        job.frame = frame;
+        job.sharedFrame = sharedFrame;
+        job.copyOnWrite = copyOnWrite;
+        job.holdShared = holdShared;
+        job.attached = attached;
+        job.mapped = mapped;
+        job.incomingPageExists = incomingPageExists;
+        job.incomingPageReplaced = incomingPageReplaced;
+        job.faultStart = faultStart;
+        job.prefetch = FALSE;
+        if (NumWorkers > 0)
         {
-            USLOSS_Console("Pager(): Could not perform mapping. Error code %d.\n", result);
-            USLOSS_Halt(1);
+            result = MboxSend(JobsMbox, &job, sizeof(PageJob));
+            if (result != 0)
+            {
+                USLOSS_Console("Pager(): MboxSend failed with error code %d.\n", result);
+                USLOSS_Halt(1);
+            }
         }
-        memcpy(page(incomingPage), buffer, USLOSS_MmuPageSize());
-        result = USLOSS_MmuUnmap(TAG, incomingPage);
-        if (result != USLOSS_MMU_OK)
+        else
         {
-            USLOSS_Console("Pager(): Could not perform unmapping. Error code %d.\n", result);
-            USLOSS_Halt(1);
+            completeFault(&job);
         }
+    }
+    if (PoolPagers)
+    {
+        poolPagerDone();
+    }
+    else
+    {
+        semvReal(PagerKillSem);
+    }
+    return 0;
+} /* Pager */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PagerWorker
+ *
+ * Kernel process that completes the faults queued by the pagers.
+ *
+ * Results:
+ * None.
+ *
+ * Side effects:
+ * None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int PagerWorker(char *arg)
+{
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("PagerWorker(): called.\n");
+    }
+    while (TRUE)
+    {
+        PageJob job;
+        int result = MboxReceive(JobsMbox, &job, sizeof(PageJob));
+        if (result < 0)
+        {
+            USLOSS_Console("PagerWorker(): MboxReceive failed with error code %d.\n", result);
+            break;
+        }
+        if (job.pid < 0)
+        {
+            break;
+        }
+        lockMutex(vmStatsMutex);
+        vmStats.workerJobs++;
+        unlockMutex(vmStatsMutex);
+        completeFault(&job);
+    }
+    semvReal(PagerKillSem);
+    return 0;
+} /* PagerWorker */
 
-        // Mark the buffer as clean
-        result = USLOSS_MmuSetAccess(frame, access & ~USLOSS_MMU_DIRTY);
+/*
+ *----------------------------------------------------------------------
+ *
+ * completeFault
+ *
+ * Finishes a fault once a pager has chosen and locked its frame: evicts
+ * the page in the frame, brings in the faulting page, and wakes the
+ * faulting process. This is the part of a fault that waits on the disk.
+ *
+ * Results:
+ * None.
+ *
+ * Side effects:
+ * The faulting page is loaded into the frame.
+ *
+ *----------------------------------------------------------------------
+ */
+static void completeFault(PageJob *job)
+{
+    int pid = job->pid;
+    int incomingPage = job->incomingPage;
+    int frame = job->frame;
+    int sharedFrame = job->sharedFrame;
+    int copyOnWrite = job->copyOnWrite;
+    int holdShared = job->holdShared;
+    int attached = job->attached;
+    int mapped = job->mapped;
+    int incomingPageExists = job->incomingPageExists;
+    int incomingPageReplaced = job->incomingPageReplaced;
+    int faultStart = job->faultStart;
+    FaultMsg *fault = &faults[pid];
+    Process *proc = getProc(pid);
+    PTE *home = homePTE(&proc->pageTable[incomingPage]);
+    int result;
+
+    if (!job->prefetch)
+    {
+        fault->receivedFrame = frame;
+    }
+
+    // Update vmStats
+    if (job->prefetch)
+    {
+        lockMutex(vmStatsMutex);
+        vmStats.prefetched++;
+        unlockMutex(vmStatsMutex);
+    }
+    else if (copyOnWrite)
+    {
+        lockMutex(vmStatsMutex);
+        vmStats.cowFaults++;
+        unlockMutex(vmStatsMutex);
+    }
+    else if (!incomingPageExists)
+    {
+        lockMutex(vmStatsMutex);
+        vmStats.new++;
+        unlockMutex(vmStatsMutex);
+    }
+    else if (incomingPageReplaced)
+    {
+        lockMutex(vmStatsMutex);
+        vmStats.refaults++;
+        unlockMutex(vmStatsMutex);
+    }
+
+    // Check the access bits
+    int access;
+    result = USLOSS_MmuGetAccess(frame, &access);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("completeFault(): Could not read frame access bits.\n");
+        USLOSS_Halt(1);
+    }
+
+    // Evict the outgoing page, writing it to disk if necessary
+    if (FrameTable[frame].page != EMPTY && !evictFrame(frame))
+    {
+        USLOSS_Console("completeFault(): Swap disk has run out of space.\n");
+        lockMutex(FramesMutex);
+        FrameTable[frame].locked = FALSE;
+        if (holdShared)
+        {
+            FrameTable[sharedFrame].locked = FALSE;
+        }
+        if (attached)
+        {
+            home->frame = EMPTY;
+        }
+        proc->pageTable[incomingPage].loading = FALSE;
+        unlockMutex(FramesMutex);
+        if (!job->prefetch)
+        {
+            fault->shouldTerminate = TRUE;
+            semVProc(pid);
+        }
+        return;
+    }
+
+    // Update the tables. The owner of a prefetched page may run while it
+    // loads, so its page table entry is only filled in once the page is in.
+    FrameTable[frame].page = incomingPage;
+    FrameTable[frame].pid = pid;
+    if (!job->prefetch)
+    {
+        proc->pageTable[incomingPage].state = INMEM;
+        proc->pageTable[incomingPage].frame = frame;
+        proc->pageTable[incomingPage].cow = FALSE;
+        home->state = INMEM;
+    }
+
+    // Initialize the buffer to match the incoming page
+    char buffer[USLOSS_MmuPageSize()];
+    int cached = !copyOnWrite && !attached && !mapped && incomingPageExists &&
+            cacheGetPage(buffer, pid, incomingPage);
+    if (copyOnWrite)
+    {
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("completeFault(): Copying shared frame %d for page %d of pid %d.\n", sharedFrame, incomingPage, pid);
+        }
+        readFrame(buffer, sharedFrame, incomingPage);
+    }
+    else if (cached)
+    {
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("completeFault(): Found page %d in the swap cache for pid %d.\n", incomingPage, pid);
+        }
+    }
+    else if (mapped)
+    {
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("completeFault(): Reading page %d from disk %d for pid %d.\n", incomingPage, home->mapUnit, pid);
+        }
+        readMappedPage(buffer, home);
+    }
+    else if (incomingPageExists && home->diskBlock != EMPTY)
+    {
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("completeFault(): Reading page %d from disk for pid %d.\n", incomingPage, pid);
+        }
+        readPageFromDisk(buffer, pid, incomingPage);
+    }
+    else
+    {
+        for (int i = 0; i < USLOSS_MmuPageSize(); i++)
+        {
+            buffer[i] = 0;
+        }
+    }
+
+    // Write the buffer
+    result = USLOSS_MmuMap(TAG, incomingPage, frame, USLOSS_MMU_PROT_RW);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("completeFault(): Could not perform mapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+    memcpy(page(incomingPage), buffer, USLOSS_MmuPageSize());
+    result = USLOSS_MmuUnmap(TAG, incomingPage);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("completeFault(): Could not perform unmapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+
+    // Mark the buffer as clean. A page from the swap cache or a copied
+    // shared page has no up to date copy on disk, so it stays dirty.
+    if (cached || copyOnWrite)
+    {
+        access |= USLOSS_MMU_DIRTY;
+    }
+    else
+    {
+        access &= ~USLOSS_MMU_DIRTY;
+    }
+    result = USLOSS_MmuSetAccess(frame, access);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("completeFault(): Could not set frame access bits.\n");
+        USLOSS_Halt(1);
+    }
+
+    // Let the replacement policy know about the new page, and release
+    // the shared frame that was copied
+    lockMutex(FramesMutex);
+    frameLoaded(frame, pid, incomingPage);
+    if (attached)
+    {
+        segmentLoaded(&proc->pageTable[incomingPage], frame);
+    }
+    if (holdShared)
+    {
+        FrameTable[sharedFrame].locked = FALSE;
+        unshareFrame(sharedFrame, pid, incomingPage);
+    }
+    if (job->prefetch)
+    {
+        // No faulting process unlocks the frame of a prefetched page
+        proc->pageTable[incomingPage].state = INMEM;
+        proc->pageTable[incomingPage].frame = frame;
+        proc->pageTable[incomingPage].loading = FALSE;
+        FrameTable[frame].locked = FALSE;
+    }
+    unlockMutex(FramesMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("completeFault(): Finished paging page %d to frame %d for proc %d.\n", incomingPage, frame, pid);
+    }
+
+    if (job->prefetch)
+    {
+        return;
+    }
+
+    // Unblock the waiting process
+    semVProc(pid);
+
+    // Check whether the system is thrashing
+    checkLoad(currentTime() - faultStart);
+    kickMerger();
+} /* completeFault */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * prefetchPage
+ *
+ * Brings the given swapped-out page of the given process into a free
+ * frame ahead of a fault on it. No page is evicted for a prefetch.
+ *
+ * Results:
+ * TRUE if the page was brought in, FALSE if it is not on disk, the
+ * process is quitting, or no frame is free.
+ *
+ * Side effects:
+ * A fault on the page while it loads is retried until it is in.
+ *
+ *----------------------------------------------------------------------
+ */
+int prefetchPage(int pid, int page)
+{
+    Process *proc = getProc(pid);
+    PTE *pte = &proc->pageTable[page];
+
+    lockMutex(FramesMutex);
+    int frame = EMPTY;
+    if (proc->pid == pid && !proc->quitting && pte->state == ONDISK &&
+            pte->segment == EMPTY && !pte->loading)
+    {
+        for (int i = 0; i < NumFrames && frame == EMPTY; i++)
+        {
+            if (FrameTable[i].page == EMPTY && !FrameTable[i].locked)
+            {
+                frame = i;
+            }
+        }
+    }
+    if (frame != EMPTY)
+    {
+        FrameTable[frame].locked = TRUE;
+        pte->loading = TRUE;
+        proc->prefetching++;
+    }
+    unlockMutex(FramesMutex);
+    if (frame == EMPTY)
+    {
+        return FALSE;
+    }
+    loadPage(pid, page, frame);
+
+    lockMutex(FramesMutex);
+    proc->prefetching--;
+    unlockMutex(FramesMutex);
+    return TRUE;
+} /* prefetchPage */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * mapResident
+ *
+ * Maps the given page of the current process if it is in memory and not
+ * mapped yet. Shared frames are mapped read-only.
+ *
+ * Results:
+ * None.
+ *
+ * Side effects:
+ * None.
+ *
+ *----------------------------------------------------------------------
+ */
+void mapResident(int pageNum)
+{
+    PTE *pte = &getProc(getpid())->pageTable[pageNum];
+    lockMutex(FramesMutex);
+    int mapped;
+    int protection;
+    if (pte->state == INMEM && pte->frame != EMPTY &&
+            USLOSS_MmuGetMap(TAG, pageNum, &mapped, &protection) == USLOSS_MMU_ERR_NOMAP)
+    {
+        protection = pte->cow ? USLOSS_MMU_PROT_READ : USLOSS_MMU_PROT_RW;
+        int result = USLOSS_MmuMap(TAG, pageNum, pte->frame, protection);
         if (result != USLOSS_MMU_OK)
         {
-            USLOSS_Console("Pager(): Could not set frame access bits.\n");
+            USLOSS_Console("mapResident(): Could not perform mapping. Error code %d.\n", result);
             USLOSS_Halt(1);
         }
+    }
+    unlockMutex(FramesMutex);
+} /* mapResident */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * populatePage
+ *
+ * Brings the given page of the current process into memory and maps it,
+ * so that touching it does not fault. An unused or swapped-out page is
+ * loaded by the process itself, replacing another process's page if no
+ * frame is free. Other pages, and pages that could not be loaded that
+ * way, take the usual fault path. If write is set, a shared page is copied into a
+ * private frame as well.
+ *
+ * Results:
+ * None.
+ *
+ * Side effects:
+ * The process is terminated if the swap disk runs out of space.
+ *
+ *----------------------------------------------------------------------
+ */
+void populatePage(int pageNum, int write)
+{
+    int pid = getpid();
+    Process *proc = getProc(pid);
+    PTE *pte = &proc->pageTable[pageNum];
+
+    lockMutex(FramesMutex);
+    int frame = EMPTY;
+    if (pte->state != INMEM && pte->segment == EMPTY && !pte->loading &&
+            (pte->state == ONDISK || write || ZeroFrame == EMPTY))
+    {
+        adjustTarget(pid);
+        frame = getNextFrame(pid);
+    }
+    // A page of ours in the frame stays mapped while we run, and would be
+    // mapped again if we were switched out and back in during the load, so
+    // replacing our own pages is left to the pagers
+    for (int i = 0; i < NumPages && frame != EMPTY; i++)
+    {
+        if (proc->pageTable[i].frame == frame)
+        {
+            frame = EMPTY;
+        }
+    }
+    if (frame != EMPTY)
+    {
+        FrameTable[frame].locked = TRUE;
+        pte->loading = TRUE;
+    }
+    unlockMutex(FramesMutex);
+    if (frame != EMPTY)
+    {
+        loadPage(pid, pageNum, frame);
+        if (pte->state == INMEM)
+        {
+            lockMutex(vmStatsMutex);
+            vmStats.populated++;
+            unlockMutex(vmStatsMutex);
+        }
+    }
+
+    void *offset = (void *) ((long) pageNum * USLOSS_MmuPageSize());
+    while (pte->state != INMEM || pte->frame == EMPTY || (write && pte->cow))
+    {
+        faultIn(offset, pte->state == INMEM ? USLOSS_MMU_ACCESS : USLOSS_MMU_FAULT);
+    }
+    mapResident(pageNum);
+} /* populatePage */
+
+/*
+ *  Load the given page of the given process into the given frame, which
+ *  the caller has locked, with no process waiting for it. The page must be
+ *  marked loading.
+ */
+static void loadPage(int pid, int page, int frame)
+{
+    PTE *pte = &getProc(pid)->pageTable[page];
+    PageJob job;
+    job.pid = pid;
+    job.incomingPage = page;
+    job.frame = frame;
+    job.sharedFrame = EMPTY;
+    job.copyOnWrite = FALSE;
+    job.holdShared = FALSE;
+    job.attached = FALSE;
+    job.mapped = pte->mapUnit != EMPTY;
+    job.incomingPageExists = pte->state != UNUSED;
+    job.incomingPageReplaced = pte->state == ONDISK;
+    job.faultStart = currentTime();
+    job.prefetch = TRUE;
+    completeFault(&job);
+}
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * evictFrame
+ *
+ * Removes the page in the given frame from its owner's page table,
+ * writing it to disk first if it is dirty. The pages sharing a shared
+ * frame, or attached to the same segment page, are all removed. The
+ * caller must have locked the frame.
+ *
+ * Results:
+ * FALSE if the swap disk has run out of space, TRUE otherwise.
+ *
+ * Side effects:
+ * The owner's page table entry is marked ONDISK before the page is
+ * written out, so that the owner cannot map the frame meanwhile.
+ *
+ *----------------------------------------------------------------------
+ */
+static int evictFrame(int frame)
+{
+    int outgoingPage = FrameTable[frame].page;
+    Process *outgoingPageProc = getProc(FrameTable[frame].pid);
+    PTE *pte = &outgoingPageProc->pageTable[outgoingPage];
+    int attached = pte->segment != EMPTY;
+    int mapped = pte->mapUnit != EMPTY;
+
+    // Take the page out of the page tables that map it before reading it
+    // out of the frame. A write to it after that would be lost. A fault on
+    // it is retried until the page is written.
+    lockMutex(FramesMutex);
+    if (attached)
+    {
+        hideSegmentPage(pte);
+    }
+    else
+    {
+        pte->loading = TRUE;
+        pte->state = ONDISK;
+        pte->frame = EMPTY;
+    }
+    unlockMutex(FramesMutex);
+    int dirty = getFrameAccess(frame) & USLOSS_MMU_DIRTY;
+
+    // Read the page out of the frame
+    char buffer[USLOSS_MmuPageSize()];
+    if (dirty)
+    {
+        readFrame(buffer, frame, outgoingPage);
+    }
+
+    // An all-zero page needs no copy anywhere; drop its swap space so the
+    // next fault zero-fills it
+    if (dirty && ZeroPageElision && !mapped && isZeroPage(buffer))
+    {
         if (DEBUG5 && debugflag5)
         {
-            USLOSS_Console("Pager(): Finished paging page %d to frame %d for proc %d.\n", incomingPage, frame, pid);
+            USLOSS_Console("evictFrame(): Eliding zero page %d for pid %d.\n", outgoingPage, outgoingPageProc->pid);
         }
+        swapFree(homePTE(pte));
+        lockMutex(vmStatsMutex);
+        vmStats.zeroPagesElided++;
+        unlockMutex(vmStatsMutex);
+        dirty = FALSE;
+    }
 
-        // Unblock the waiting process
-        semVProc(pid);
+    // Keep a compressed copy in memory if the swap cache will take it;
+    // otherwise write to disk. The sharers of a shared frame and the
+    // processes attached to a segment all need the disk copy.
+    int shared = FrameTable[frame].sharers > 0 || attached;
+    int cached = dirty && !shared && !mapped && cachePutPage(buffer, outgoingPageProc->pid, outgoingPage);
+    if (dirty && mapped)
+    {
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("evictFrame(): Writing page %d back to disk %d for pid %d.\n", outgoingPage, pte->mapUnit, outgoingPageProc->pid);
+        }
+        writeMappedPage(buffer, pte);
     }
-    semvReal(PagerKillSem);
-    return 0;
-} /* Pager */
+    else if (dirty && !cached)
+    {
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("evictFrame(): Writing page %d to disk for pid %d.\n", outgoingPage, outgoingPageProc->pid);
+        }
+        if (!writePageToDisk(buffer, outgoingPageProc->pid, outgoingPage))
+        {
+            // The page stays in the frame. A segment page is mapped
+            // again by the next fault on it.
+            lockMutex(FramesMutex);
+            if (!attached)
+            {
+                pte->state = INMEM;
+                pte->frame = frame;
+                pte->loading = FALSE;
+            }
+            unlockMutex(FramesMutex);
+            return FALSE;
+        }
+    }
+
+    // Update the tables
+    lockMutex(FramesMutex);
+    if (attached)
+    {
+        segmentEvicted(pte);
+    }
+    evictSharers(frame, pte);
+    pte->state = ONDISK;
+    pte->frame = EMPTY;
+    pte->cow = FALSE;
+    pte->loading = FALSE;
+    unlockMutex(FramesMutex);
+    return TRUE;
+} /* evictFrame */
+
+/*
+ *  Set aside the last frame as the shared zero frame, if enabled. The
+ *  frame stays locked so that it is never handed out or replaced.
+ */
+static void initZeroFrame()
+{
+    ZeroFrame = EMPTY;
+    if (!SharedZeroFrame || NumFrames < 2 || NumPages < 1)
+    {
+        return;
+    }
+    ZeroFrame = NumFrames - 1;
+    FrameTable[ZeroFrame].locked = TRUE;
+
+    int dummy;
+    char *region = USLOSS_MmuRegion(&dummy);
+    int result = USLOSS_MmuMap(TAG, 0, ZeroFrame, USLOSS_MMU_PROT_RW);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("initZeroFrame(): Could not perform mapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+    memset(region, 0, USLOSS_MmuPageSize());
+    result = USLOSS_MmuUnmap(TAG, 0);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("initZeroFrame(): Could not perform unmapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+    setFrameAccess(ZeroFrame, 0);
+}
+
+/*
+ *  Copy the contents of the given frame into the buffer, borrowing the
+ *  given page of the VM region to reach it
+ */
+static void readFrame(char *buffer, int frame, int pageNum)
+{
+    if (frame == ZeroFrame)
+    {
+        memset(buffer, 0, USLOSS_MmuPageSize());
+        return;
+    }
+    int result = USLOSS_MmuMap(TAG, pageNum, frame, USLOSS_MMU_PROT_RW);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("readFrame(): Could not perform mapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+    memcpy(buffer, page(pageNum), USLOSS_MmuPageSize());
+    result = USLOSS_MmuUnmap(TAG, pageNum);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("readFrame(): Could not perform unmapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ *  Returns TRUE if every byte of the given page buffer is zero
+ */
+static int isZeroPage(char *buffer)
+{
+    for (int i = 0; i < USLOSS_MmuPageSize(); i++)
+    {
+        if (buffer[i] != 0)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * releaseFrame
+ *
+ * Evicts the page in the given frame, which the caller has locked, and
+ * frees the frame.
+ *
+ * Results:
+ * FALSE if the page could not be written out because the swap disk is
+ * full, in which case it stays in the frame.
+ *
+ * Side effects:
+ * The frame is unlocked.
+ *
+ *----------------------------------------------------------------------
+ */
+int releaseFrame(int frame)
+{
+    int evicted = evictFrame(frame);
+    lockMutex(FramesMutex);
+    if (evicted)
+    {
+        FrameTable[frame].page = EMPTY;
+        FrameTable[frame].pid = EMPTY;
+        setFrameList(frame, EMPTY);
+        FrameTable[frame].warm = FALSE;
+        FrameTable[frame].sharers = 0;
+        setFrameAccess(frame, 0);
+    }
+    FrameTable[frame].locked = FALSE;
+    unlockMutex(FramesMutex);
+    return evicted;
+} /* releaseFrame */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * swapOutProcess
+ *
+ * Evicts every resident page of the given process and frees its
+ * frames. Frames that are locked by a fault in progress are skipped.
+ * Pages are evicted in page order, and up to SWAP_CLUSTER neighbouring
+ * dirty private pages are written together, in one request for the ones
+ * whose swap blocks follow each other.
+ *
+ * Results:
+ * The number of frames freed.
+ *
+ * Side effects:
+ * Dirty pages are written to disk.
+ *
+ *----------------------------------------------------------------------
+ */
+int swapOutProcess(int pid)
+{
+    Process *proc = getProc(pid);
+    int freed = 0;
+    for (int page = 0; page < NumPages; )
+    {
+        // Lock the frames of a cluster starting at the page, or else of
+        // the page alone
+        int frames[SWAP_CLUSTER];
+        int count = 0;
+        lockMutex(FramesMutex);
+        while (page + count < NumPages && count < SWAP_CLUSTER &&
+                (frames[count] = clusterFrame(proc, page + count)) != EMPTY)
+        {
+            FrameTable[frames[count]].locked = TRUE;
+            count++;
+        }
+        int single = count == 0 ? ownedFrame(proc, page) : EMPTY;
+        if (single != EMPTY)
+        {
+            FrameTable[single].locked = TRUE;
+        }
+        unlockMutex(FramesMutex);
+
+        if (count > 0)
+        {
+            int done = writeCluster(pid, page, frames, count);
+            freed += done;
+            page += count;
+            if (done < count)
+            {
+                break;
+            }
+            continue;
+        }
+        page++;
+        if (single == EMPTY)
+        {
+            continue;
+        }
+        if (!releaseFrame(single))
+        {
+            break;
+        }
+        freed++;
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("swapOutProcess(): Freed %d frames from pid %d.\n", freed, pid);
+    }
+    return freed;
+} /* swapOutProcess */
+
+/*
+ *  Returns the frame holding the given page of the given process if
+ *  swapOutProcess may evict it, or EMPTY. Must be called with the frames
+ *  mutex held.
+ */
+static int ownedFrame(Process *proc, int page)
+{
+    int frame = proc->pageTable[page].frame;
+    if (frame == EMPTY || FrameTable[frame].pid != proc->pid || FrameTable[frame].page != page ||
+            FrameTable[frame].locked || framePinned(frame) || proc->quitting)
+    {
+        return EMPTY;
+    }
+    return frame;
+}
+
+/*
+ *  Returns the frame holding the given page of the given process if it can
+ *  be written out in a cluster: a dirty page that only this process uses
+ *  and that would go to swap rather than the swap cache. Returns EMPTY
+ *  otherwise. Must be called with the frames mutex held.
+ */
+static int clusterFrame(Process *proc, int page)
+{
+    PTE *pte = &proc->pageTable[page];
+    int frame = ownedFrame(proc, page);
+    if (frame == EMPTY || pte->cow || pte->segment != EMPTY || pte->mapUnit != EMPTY ||
+            FrameTable[frame].sharers > 0 || SwapCacheSize > 0 ||
+            !(getFrameAccess(frame) & USLOSS_MMU_DIRTY))
+    {
+        return EMPTY;
+    }
+    return frame;
+}
+
+/*
+ *  Write the given count of neighbouring pages of the process with the
+ *  given pid, starting at the given page, out of the given frames, which
+ *  the caller has locked, and free the frames. Returns the number of
+ *  frames freed, from the first, which is less than count only if the
+ *  swap disk is full. Every frame is unlocked.
+ */
+static int writeCluster(int pid, int first, int *frames, int count)
+{
+    Process *proc = getProc(pid);
+    int size = USLOSS_MmuPageSize();
+    char *buffer = malloc(count * size);
+    if (buffer == NULL)
+    {
+        USLOSS_Console("writeCluster(): Could not malloc the cluster.\n");
+        USLOSS_Halt(1);
+    }
+
+    // Unmap the pages from the process's page table first, so that it
+    // cannot write to them while they are written out. A fault on one is
+    // retried until the write is done.
+    lockMutex(FramesMutex);
+    for (int k = 0; k < count; k++)
+    {
+        PTE *pte = &proc->pageTable[first + k];
+        pte->loading = TRUE;
+        pte->frame = EMPTY;
+    }
+    unlockMutex(FramesMutex);
+
+    // Copy the pages out, eliding the all-zero ones
+    PTE *ptes[SWAP_CLUSTER];
+    int pages[SWAP_CLUSTER];
+    int slots[SWAP_CLUSTER];
+    int writes = 0;
+    for (int k = 0; k < count; k++)
+    {
+        PTE *pte = &proc->pageTable[first + k];
+        readFrame(buffer + writes * size, frames[k], first + k);
+        if (ZeroPageElision && isZeroPage(buffer + writes * size))
+        {
+            swapFree(pte);
+            slots[k] = EMPTY;
+            lockMutex(vmStatsMutex);
+            vmStats.zeroPagesElided++;
+            unlockMutex(vmStatsMutex);
+            continue;
+        }
+        ptes[writes] = pte;
+        pages[writes] = first + k;
+        slots[k] = writes++;
+    }
+    int written = swapWriteRun(buffer, ptes, pid, pages, writes);
+    free(buffer);
+
+    lockMutex(vmStatsMutex);
+    vmStats.pageOuts += written;
+    unlockMutex(vmStatsMutex);
+
+    // Free the frames of the pages that are stored, up to the first that
+    // did not fit. The rest stay in their frames.
+    int freed = 0;
+    lockMutex(FramesMutex);
+    for (int k = 0; k < count; k++)
+    {
+        int frame = frames[k];
+        PTE *pte = &proc->pageTable[first + k];
+        pte->loading = FALSE;
+        if (freed < k || slots[k] >= written)
+        {
+            pte->frame = frame;
+        }
+        else
+        {
+            pte->state = ONDISK;
+            FrameTable[frame].page = EMPTY;
+            FrameTable[frame].pid = EMPTY;
+            setFrameList(frame, EMPTY);
+            FrameTable[frame].warm = FALSE;
+            setFrameAccess(frame, 0);
+            freed++;
+        }
+        FrameTable[frame].locked = FALSE;
+    }
+    unlockMutex(FramesMutex);
+    return freed;
+}
@@ -20,6 +20,172 @@
  * Maximum number of pagers.
  */
 #define MAXPAGERS 4
+#define MAXWORKERS 8
+#define MAXPOOL 16
+
+/*
+ * Page replacement policies. Set ReplacementPolicy before calling VmInit.
+ */
+#define POLICY_CLOCK	0   // Second-chance clock
+#define POLICY_CAR	1   // Clock with adaptive replacement (scan resistant)
+#define POLICY_WSCLOCK	2   // Clock that prefers pages outside their working set
+
+extern int ReplacementPolicy;
+
+/*
+ * Working set window, in microseconds of process virtual time. A page that
+ * its owner has not referenced within the window is outside its working set.
+ */
+extern int WorkingSetWindow;
+
+/*
+ * Frame allocation policies. Under ALLOC_PFF each process has a target
+ * resident set size driven by its page fault frequency, and victims are
+ * taken from processes over their target.
+ */
+#define ALLOC_GLOBAL	0
+#define ALLOC_PFF	1
+
+extern int FrameAllocation;
+
+/*
+ * Size in bytes of the compressed in-memory swap cache that sits in front of
+ * the swap disk. Set before calling VmInit; 0 disables the cache.
+ */
+extern int SwapCacheSize;
+
+/*
+ * Number of disk units the swap space is striped across, 1 or 2. Unit
+ * SWAPDISK comes first. Set before calling VmInit.
+ */
+extern int SwapDisks;
+
+/*
+ * Set before calling VmInit to give each process extents of adjacent swap
+ * blocks, aligned to tracks, that keep neighbouring pages together on disk
+ * so a swap read can bring in the pages after it too.
+ */
+extern int SwapExtents;
+
+/*
+ * Number of pager workers, at most MAXWORKERS. With workers, a pager only
+ * chooses the frame for a fault and queues the disk I/O for a worker, so
+ * it can take the next fault while earlier ones wait on the disk. With
+ * none, each pager handles its faults from start to finish. Set before
+ * calling VmInit.
+ */
+extern int PagerWorkers;
+
+/*
+ * Most pagers the pager pool may grow to, at most MAXPOOL. If it is above
+ * the number of pagers given to VmInit, pagers are added while faults
+ * queue up faster than the pagers take them, and retired again once the
+ * backlog has cleared. Set before calling VmInit; 0 keeps the pool fixed.
+ */
+extern int MaxPagers;
+
+/*
+ * Set before calling VmInit to prefetch a process's working set when it is
+ * switched back in: the swapped-out pages it referenced within the working
+ * set window are read into free frames ahead of its faults on them.
+ */
+extern int SwitchPrefetch;
+
+/*
+ * Microseconds a process may stay blocked before a swapper evicts all of
+ * its resident pages, freeing its frames for the processes that are
+ * running. Set before calling VmInit; 0 leaves idle processes alone.
+ */
+extern int IdleSwapTime;
+
+/*
+ * Set before calling VmInit to lay the swap space out as a log: every
+ * page-out is appended at the log head, and a cleaner compacts the live
+ * pages out of mostly dead parts of the log.
+ */
+extern int LogSwap;
+
+/*
+ * Set before calling VmInit to send swap I/O to each disk one request at a
+ * time, in C-SCAN track order, instead of in arrival order. Reads that have
+ * waited too long go first.
+ */
+extern int SwapScheduler;
+
+/*
+ * Set before calling VmInit to compress pages on the swap disk, packing
+ * several compressed pages into each disk block.
+ */
+extern int CompressedSwap;
+
+/*
+ * Set before calling VmInit to drop dirty pages that are entirely zero
+ * instead of writing them out; the next fault zero-fills them again.
+ */
+extern int ZeroPageElision;
+
+/*
+ * Set before calling VmInit to map untouched pages to one shared read-only
+ * frame of zeros. A process gets a private frame on its first write.
+ */
+extern int SharedZeroFrame;
+
+/*
+ * Set before calling VmInit to run a background scanner that merges pages
+ * with identical contents, across processes, into shared read-only frames.
+ */
+extern int PageMerging;
+
+/*
+ * Set before calling VmInit to deactivate processes while the system is
+ * thrashing.
+ */
+extern int LoadControl;
+
+/*
+ * System call numbers for the VM system calls beyond VmInit and VmDestroy.
+ * They follow SYS_VMDESTROY in one run, which must end below MAXSYSCALLS,
+ * the size of systemCallVec.
+ */
+#define SYS_VMLIMIT	31
+#define SYS_VMSHMCREATE	32
+#define SYS_VMSHMATTACH	33
+#define SYS_VMSHMDETACH	34
+#define SYS_VMSPAWN	35
+#define SYS_VMMAP	36
+#define SYS_VMSYNC	37
+#define SYS_VMUNMAP	38
+#define SYS_VMADVISE	39
+#define SYS_VMLOCK	40
+#define SYS_VMUNLOCK	41
+#define SYS_VMPOPULATE	42
+#define SYS_VMRESIDENT	43
+
+#if defined(SYS_VMDESTROY) && SYS_VMLIMIT != SYS_VMDESTROY + 1
+#error "the VM system call numbers do not follow SYS_VMDESTROY"
+#endif
+#if SYS_VMRESIDENT >= MAXSYSCALLS
+#error "the VM system call numbers do not fit in systemCallVec"
+#endif
+
+/*
+ * Hints for VmAdvise. The first three set how a range of pages is expected
+ * to be used; the others act on the pages at once.
+ */
+#define VM_ADV_NORMAL		0   // No particular pattern
+#define VM_ADV_SEQUENTIAL	1   // Used in page order, each page once
+#define VM_ADV_RANDOM		2   // Used in no particular order
+#define VM_ADV_WILLNEED		3   // Bring the swapped-out pages in now
+#define VM_ADV_DONTNEED		4   // Discard the contents and free the frames and swap
+#define VM_ADV_FREE		5   // Free the swap; discard the contents if not written again
+
+/*
+ * Bits VmResident sets in the byte it reports for each page.
+ */
+#define VM_RES_INMEM	0x1 // The page is in memory
+#define VM_RES_DIRTY	0x2 // The page in memory has been written since it was loaded
+#define VM_RES_ONDISK	0x4 // The page has a copy in swap space or on its mapped disk
+#define VM_RES_PINNED	0x8 // The page is pinned by VmLock
 
 /*
  * Paging statistics
@@ -38,9 +204,51 @@ typedef struct VmStats {
     int replaced;	// # pages replaced; i.e., frame had a page and we
                         //   replaced that page in the frame with a different
                         //   page. */
+    int refaults;       // # faults on pages that had been replaced earlier
+    int ghostHits;      // # refaults found in the CAR ghost lists
+    int deactivations;  // # processes swapped out by load control
+    int reactivations;  // # processes let back in by load control
+    int targetGrows;    // # times PFF grew a process's target resident set
+    int targetShrinks;  // # times PFF shrank a process's target resident set
+    int cacheStores;    // # dirty pages compressed into the swap cache
+    int cacheHits;      // # faults satisfied from the swap cache
+    int cacheWritebacks;// # pages written from the swap cache to disk
+    int cacheBytes;     // Total compressed size of the pages stored
+    int sectorsRead;    // # sectors read from the swap disk
+    int sectorsWritten; // # sectors written to the swap disk
+    int unitReads[USLOSS_DISK_UNITS];  // # swap reads issued to each disk unit
+    int unitWrites[USLOSS_DISK_UNITS]; // # swap writes issued to each disk unit
+    int seeks;          // # swap requests sent to the disks
+    int seekTracks;     // Total tracks the heads moved for swap requests
+    int segmentsCleaned;// # log segments compacted by the cleaner
+    int runsMoved;      // # runs of live sectors the cleaner moved
+    int readAheadHits;  // # swap reads served from the read-ahead buffer
+    int prefetched;     // # pages brought in ahead of a fault on them
+    int idleSwapOuts;   // # idle processes swapped out
+    int idleFrames;     // # frames freed by swapping out idle processes
+    int workerJobs;     // # faults completed by pager workers
+    int peakPagers;     // Most pagers in the pager pool at once
+    int pagerRetires;   // # pagers retired from the pager pool
+    int zeroPagesElided;// # all-zero pages dropped instead of written out
+    int zeroFrameMaps;  // # faults satisfied by mapping the shared zero frame
+    int cowFaults;      // # writes that copied a shared page into a private frame
+    int pagesMerged;    // # pages merged into a frame with the same contents
+    int framesSaved;    // Most frames saved at once by sharing
+    int mappedReads;    // # pages read from mapped disk regions
+    int mappedWrites;   // # pages written back to mapped disk regions
+    int advisedFetches; // # pages brought in by VmAdvise
+    int advisedDrops;   // # pages whose contents VmAdvise discarded
+    int pinnedPages;    // # pages pinned by VmLock
+    int pinFaults;      // # faults taken by VmLock to bring pages in
+    int populated;      // # pages VmPopulate brought in without a fault
 } VmStats;
 
 extern VmStats	vmStats;
 extern void PrintStats();
 
+/*
+ * Set to print the extended statistics in PrintStats.
+ */
+extern int statsflag5;
+
 #endif /* _PHASE5_H */
@@ -16,10 +16,11 @@
 #include "phase5utility.h"
 #include "vm.h"
 #include "providedPrototypes.h"
+#include "swap.h"
+#include "segments.h"
 
 extern Process ProcTable[];
 extern int NumPages;
-extern int NextCheckedFrame;
 extern Frame *FrameTable;
 extern int NumFrames;
 extern void *vmRegion;
@@ -52,6 +53,17 @@ void initPageTable(int pid)
         proc->pageTable[i].state = UNUSED;
         proc->pageTable[i].frame = EMPTY;
         proc->pageTable[i].diskBlock = EMPTY;
+        proc->pageTable[i].diskSector = 0;
+        proc->pageTable[i].diskSectors = 0;
+        proc->pageTable[i].lastRef = 0;
+        proc->pageTable[i].cow = FALSE;
+        proc->pageTable[i].segment = EMPTY;
+        proc->pageTable[i].segmentPage = 0;
+        proc->pageTable[i].mapUnit = EMPTY;
+        proc->pageTable[i].mapSector = 0;
+        proc->pageTable[i].loading = FALSE;
+        proc->pageTable[i].advice = VM_ADV_NORMAL;
+        proc->pageTable[i].pinned = FALSE;
     }
 }
 
@@ -130,12 +142,7 @@ void initVmStats(VmStats *vmStats, int pages, int frames)
 
     vmStats->pages = pages;
     vmStats->frames = frames;
-    int sector;
-    int track;
-    int disk;
-    diskSizeReal(1, &sector, &track, &disk);
-    int diskSize = disk * track * sector;
-    vmStats->diskBlocks = diskSize/USLOSS_MmuPageSize();
+    vmStats->diskBlocks = swapBlocks();
     vmStats->freeFrames = frames;
     vmStats->freeDiskBlocks = vmStats->diskBlocks;
     vmStats->switches = 0;
@@ -144,6 +151,46 @@ void initVmStats(VmStats *vmStats, int pages, int frames)
     vmStats->pageIns = 0;
     vmStats->pageOuts = 0;
     vmStats->replaced = 0;
+    vmStats->refaults = 0;
+    vmStats->ghostHits = 0;
+    vmStats->deactivations = 0;
+    vmStats->reactivations = 0;
+    vmStats->targetGrows = 0;
+    vmStats->targetShrinks = 0;
+    vmStats->cacheStores = 0;
+    vmStats->cacheHits = 0;
+    vmStats->cacheWritebacks = 0;
+    vmStats->cacheBytes = 0;
+    vmStats->sectorsRead = 0;
+    vmStats->sectorsWritten = 0;
+    for (int i = 0; i < USLOSS_DISK_UNITS; i++)
+    {
+        vmStats->unitReads[i] = 0;
+        vmStats->unitWrites[i] = 0;
+    }
+    vmStats->seeks = 0;
+    vmStats->seekTracks = 0;
+    vmStats->segmentsCleaned = 0;
+    vmStats->runsMoved = 0;
+    vmStats->readAheadHits = 0;
+    vmStats->prefetched = 0;
+    vmStats->idleSwapOuts = 0;
+    vmStats->idleFrames = 0;
+    vmStats->workerJobs = 0;
+    vmStats->peakPagers = 0;
+    vmStats->pagerRetires = 0;
+    vmStats->zeroPagesElided = 0;
+    vmStats->zeroFrameMaps = 0;
+    vmStats->cowFaults = 0;
+    vmStats->mappedReads = 0;
+    vmStats->mappedWrites = 0;
+    vmStats->advisedFetches = 0;
+    vmStats->advisedDrops = 0;
+    vmStats->pinnedPages = 0;
+    vmStats->pinFaults = 0;
+    vmStats->populated = 0;
+    vmStats->pagesMerged = 0;
+    vmStats->framesSaved = 0;
 }
 
 /*
@@ -159,6 +206,34 @@ void enableInterrupts()
     }
 }
 
+/*
+ *  Disable interrupts
+ */
+void disableInterrupts()
+{
+    int result = USLOSS_PsrSet(USLOSS_PsrGet() & ~USLOSS_PSR_CURRENT_INT);
+    if (result != USLOSS_DEV_OK)
+    {
+        USLOSS_Console("disableInterrupts(): Bug in disable interrupts.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ *  Return the current time, in microseconds
+ */
+int currentTime()
+{
+    int time;
+    int result = USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &time);
+    if (result != USLOSS_DEV_OK)
+    {
+        USLOSS_Console("currentTime(): Could not read the clock.\n");
+        USLOSS_Halt(1);
+    }
+    return time;
+}
+
 /*
  *  A debugging function that prints out the mappings currently in the mmu
  */
@@ -200,54 +275,31 @@ void dumpMappings()
 }
 
 /*
- *  The function that determines the frame to use in the frame table.
- *  Return an empty frame if availabe; use the clock algorithm otherwise
+ *  Return the access bits of the given frame
  */
-int getNextFrame()
+int getFrameAccess(int frame)
 {
-    // Search for a free frame
-    for (int i = 0; i < NumFrames; i++)
+    int access;
+    int result = USLOSS_MmuGetAccess(frame, &access);
+    if (result != USLOSS_MMU_OK)
     {
-        if (FrameTable[i].page == EMPTY)
-        {
-            return i;
-        }
+        USLOSS_Console("getFrameAccess(): Could not read frame access bits.\n");
+        USLOSS_Halt(1);
     }
+    return access;
+}
 
-    // If there isn't one then use clock algorithm to replace a page
-    for (int i = 0; i < NumFrames + 1; i++)
+/*
+ *  Set the access bits of the given frame
+ */
+void setFrameAccess(int frame, int access)
+{
+    int result = USLOSS_MmuSetAccess(frame, access);
+    if (result != USLOSS_MMU_OK)
     {
-        int index = (NextCheckedFrame + i) % NumFrames;
-        if (FrameTable[index].locked)
-        {
-            continue;
-        }
-        int access;
-        int result = USLOSS_MmuGetAccess(index, &access);
-        if (result != USLOSS_MMU_OK)
-        {
-            USLOSS_Console("Pager(): Could not read frame access bits.\n");
-            USLOSS_Halt(1);
-        }
-
-        if (access & USLOSS_MMU_REF)
-        {
-            result = USLOSS_MmuSetAccess(index, access & ~USLOSS_MMU_REF);
-
-            if (result != USLOSS_MMU_OK)
-            {
-                USLOSS_Console("Pager(): Could not set frame access bits.\n");
-                USLOSS_Halt(1);
-            }
-        }
-        else
-        {
-            NextCheckedFrame = (index + 1) % NumFrames;
-            return index;
-        }
+        USLOSS_Console("setFrameAccess(): Could not set frame access bits.\n");
+        USLOSS_Halt(1);
     }
-
-    return EMPTY;
 }
 
 /*
@@ -259,7 +311,9 @@ void *page(int pageNum)
 }
 
 /*
- *  Read the given page in the process with the given pid from disk into the buffer
+ *  Read the given page in the process with the given pid from disk into the buffer.
+ *  A page of a shared segment is read from the segment's swap space. A page
+ *  that is being prefetched is still ONDISK until it has been read.
  */
 void readPageFromDisk(char *buffer, int pid, int page)
 {
@@ -269,57 +323,52 @@ void readPageFromDisk(char *buffer, int pid, int page)
     vmStats.pageIns++;
     unlockMutex(vmStatsMutex);
 
-    Process *proc = getProc(pid);
-    int diskBlock = proc->pageTable[page].diskBlock;
-    if (diskBlock == EMPTY)
+    PTE *view = &getProc(pid)->pageTable[page];
+    PTE *pte = homePTE(view);
+    if (pte->diskBlock == EMPTY)
     {
         USLOSS_Console("readPageFromDisk(): Trying to read page without a set diskBlock. pid %d page %d.\n", pid, page);
         USLOSS_Halt(1);
     }
-    else if (proc->pageTable[page].state != INMEM)
+    else if (pte->state != INMEM && !view->loading)
     {
         USLOSS_Console("readPageFromDisk(): Trying to read page that does not belong INMEM. pid %d page %d.\n", pid, page);
         USLOSS_Halt(1);
     }
 
-    int sectorsPerPage = USLOSS_MmuPageSize() / USLOSS_DISK_SECTOR_SIZE;
-    int totalSectors = sectorsPerPage * diskBlock;
-    int track = totalSectors / USLOSS_DISK_TRACK_SIZE;
-    int sector = totalSectors % USLOSS_DISK_TRACK_SIZE;
-
     // Read into a buffer
-    diskReadReal(SWAPDISK, track, sector, sectorsPerPage, buffer);
+    swapRead(buffer, pte);
 }
 
 /*
- *  Write the given page in the process with the given pid from the buffer into the disk
+ *  Write the given page in the process with the given pid from the buffer into the disk.
+ *  Swap space is allocated for the page if it has none. A page of a shared
+ *  segment is written to the segment's swap space. A private page is already
+ *  marked ONDISK while it is written out.
+ *  Returns FALSE if the swap disk has run out of space.
  */
-void writePageToDisk(char *buffer, int pid, int page)
+int writePageToDisk(char *buffer, int pid, int page)
 {
     CheckMode();
 
-    lockMutex(vmStatsMutex);
-    vmStats.pageOuts++;
-    unlockMutex(vmStatsMutex);
-
-    Process *proc = getProc(pid);
-    int diskBlock = proc->pageTable[page].diskBlock;
-    if (diskBlock == EMPTY)
+    PTE *view = &getProc(pid)->pageTable[page];
+    PTE *pte = homePTE(view);
+    if (pte->state != INMEM && !view->loading)
     {
-        USLOSS_Console("writePageToDisk(): Trying to write page without a set diskBlock. pid %d page %d.\n", pid, page);
+        USLOSS_Console("writePageToDisk(): Trying to write page that is not being evicted. pid %d page %d.\n", pid, page);
         USLOSS_Halt(1);
     }
-    else if (proc->pageTable[page].state != ONDISK)
+
+    // Write the contents of the buffer
+    int owner = view->segment == EMPTY ? pid : MAXPROC + view->segment;
+    int ownerPage = view->segment == EMPTY ? page : view->segmentPage;
+    if (!swapWrite(buffer, pte, owner, ownerPage))
     {
-        USLOSS_Console("writePageToDisk(): Trying to write page that does not belong ONDISK. pid %d page %d.\n", pid, page);
-        USLOSS_Halt(1);
+        return FALSE;
     }
 
-    int sectorsPerPage = USLOSS_MmuPageSize() / USLOSS_DISK_SECTOR_SIZE;
-    int totalSectors = sectorsPerPage * diskBlock;
-    int track = totalSectors / USLOSS_DISK_TRACK_SIZE;
-    int sector = totalSectors / USLOSS_DISK_TRACK_SIZE;
-
-    // Write the contents of the buffer
-    diskWriteReal(SWAPDISK, track, sector, sectorsPerPage, buffer);
+    lockMutex(vmStatsMutex);
+    vmStats.pageOuts++;
+    unlockMutex(vmStatsMutex);
+    return TRUE;
 }
@@ -17,9 +17,13 @@ extern Process *getProc(int);
 extern void semPProc();
 extern void semVProc(int);
 extern void enableInterrupts();
+extern void disableInterrupts();
+extern int currentTime();
 extern void dumpMappings();
-extern int getNextFrame();
+extern int getFrameAccess(int);
+extern void setFrameAccess(int, int);
 extern void *page(int);
-extern void writePageToDisk(char *, int, int);
+extern int writePageToDisk(char *, int, int);
 extern void readPageFromDisk(char *, int, int);
+extern void releaseProcess(int);
 #endif
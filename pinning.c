@@ -0,0 +1,244 @@
+/*
+ *  File:  pinning.c
+ *
+ *  Description:  This file contains VmLock and VmUnlock, which pin pages
+ *                of a process in memory so they are never replaced
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "mapping.h"
+#include "pinning.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int VMInitialized;
+extern Frame *FrameTable;
+extern int NumFrames;
+extern int NumPages;
+extern int FramesMutex;
+
+/*
+ * A pinned page is marked in its page table entry and stays in whatever
+ * private frame holds it, so the frame of a pinned page is pinned too.
+ * A clone made by VmSpawn shares a pinned page copy-on-write like any
+ * other page, and the first write copies it into another pinned frame.
+ * PinnedPages counts the pages pinned across all processes. VmLock counts
+ * its pins before faulting the pages in, and a process's pinsReserved
+ * holds the ones it has not made yet, so that they are given back if the
+ * process quits part way.
+ */
+static int PinnedPages;
+
+static void pinPage(int, int);
+
+/*
+ *  Initialize the pin counts
+ */
+void initPinning()
+{
+    PinnedPages = 0;
+}
+
+/*
+ *  Returns whether the page in the given frame is pinned. Must be called
+ *  with the frames mutex held.
+ */
+int framePinned(int frame)
+{
+    if (FrameTable[frame].page == EMPTY || FrameTable[frame].pid == EMPTY)
+    {
+        return FALSE;
+    }
+    PTE *pte = &getProc(FrameTable[frame].pid)->pageTable[FrameTable[frame].page];
+    return pte->pinned && pte->frame == frame;
+}
+
+/*
+ *  Unpin the given page of the given process, if it is pinned. Must be
+ *  called with the frames mutex held.
+ */
+void unpinPage(Process *proc, PTE *pte)
+{
+    if (!pte->pinned)
+    {
+        return;
+    }
+    pte->pinned = FALSE;
+    proc->pinnedPages--;
+    PinnedPages--;
+    vmStats.pinnedPages = PinnedPages;
+}
+
+/*
+ *  Unpin every page of the process with the given pid and give back the
+ *  pins it reserved but did not make
+ */
+void unpinAll(int pid)
+{
+    Process *proc = getProc(pid);
+    lockMutex(FramesMutex);
+    proc->pinnedPages -= proc->pinsReserved;
+    PinnedPages -= proc->pinsReserved;
+    proc->pinsReserved = 0;
+    vmStats.pinnedPages = PinnedPages;
+    for (int i = 0; i < NumPages && proc->pinnedPages > 0; i++)
+    {
+        unpinPage(proc, &proc->pageTable[i]);
+    }
+    unlockMutex(FramesMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmLockReal --
+ *
+ * Called by vmLock.
+ * Brings the pages in the given range of the current process's VM region
+ * into private frames and pins them there, so the process can use them
+ * without faulting. A process may pin at most PIN_PROCESS_PERCENT of its
+ * frame cap, and at most PIN_GLOBAL_PERCENT of the frames may be pinned
+ * in all. Pages of attached segments cannot be pinned.
+ *
+ * Results:
+ *      0 on success, -1 if the range is invalid or a pin limit would be
+ *      exceeded.
+ *
+ * Side effects:
+ *      The process faults in the pages that are not in memory.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmLockReal(void *addr, int pages)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    int pid = getpid();
+    Process *proc = getProc(pid);
+
+    // Reserve the pins up front so the limits hold while pages fault in
+    lockMutex(FramesMutex);
+    int newPins = 0;
+    for (int i = start; i < start + pages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        if (pte->segment != EMPTY)
+        {
+            unlockMutex(FramesMutex);
+            return -1;
+        }
+        newPins += !pte->pinned;
+    }
+    if (proc->pinnedPages + newPins > proc->maxFrames * PIN_PROCESS_PERCENT / 100 ||
+            PinnedPages + newPins > NumFrames * PIN_GLOBAL_PERCENT / 100)
+    {
+        unlockMutex(FramesMutex);
+        return -1;
+    }
+    proc->pinnedPages += newPins;
+    proc->pinsReserved = newPins;
+    PinnedPages += newPins;
+    vmStats.pinnedPages = PinnedPages;
+    unlockMutex(FramesMutex);
+
+    for (int i = start; i < start + pages; i++)
+    {
+        pinPage(pid, i);
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmLockReal(): Pinned pages %d to %d for pid %d.\n", start, start + pages - 1, pid);
+    }
+    return 0;
+} /* vmLockReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmUnlockReal --
+ *
+ * Called by vmUnlock.
+ * Unpins the pinned pages in the given range of the current process's VM
+ * region.
+ *
+ * Results:
+ *      0 on success, -1 if the range is invalid.
+ *
+ * Side effects:
+ *      The pages may be replaced again.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmUnlockReal(void *addr, int pages)
+{
+    CheckMode();
+
+    int start;
+    if (!VMInitialized || !pageRange(addr, pages, &start))
+    {
+        return -1;
+    }
+    Process *proc = getProc(getpid());
+    lockMutex(FramesMutex);
+    for (int i = start; i < start + pages; i++)
+    {
+        unpinPage(proc, &proc->pageTable[i]);
+    }
+    unlockMutex(FramesMutex);
+    return 0;
+} /* vmUnlockReal */
+
+/*
+ *  Fault the given page of the process with the given pid into a private
+ *  frame until it stays there, then pin it. A shared page gets a write
+ *  fault, so that it is copied.
+ */
+static void pinPage(int pid, int pageNum)
+{
+    PTE *pte = &getProc(pid)->pageTable[pageNum];
+    lockMutex(FramesMutex);
+    while (pte->state != INMEM || pte->frame == EMPTY || pte->cow ||
+            FrameTable[pte->frame].locked)
+    {
+        int resident = pte->state == INMEM && pte->frame != EMPTY;
+        unlockMutex(FramesMutex);
+        if (resident && !pte->cow)
+        {
+            // Someone is using the frame; wait for it to be let go
+            int status;
+            waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+        }
+        else
+        {
+            int cause = resident ? USLOSS_MMU_ACCESS : USLOSS_MMU_FAULT;
+            faultIn((void *) ((long) pageNum * USLOSS_MmuPageSize()), cause);
+
+            lockMutex(vmStatsMutex);
+            vmStats.pinFaults++;
+            unlockMutex(vmStatsMutex);
+        }
+        lockMutex(FramesMutex);
+    }
+    if (!pte->pinned)
+    {
+        pte->pinned = TRUE;
+        getProc(pid)->pinsReserved--;
+    }
+    unlockMutex(FramesMutex);
+}
@@ -0,0 +1,17 @@
+/*
+ * pinning.h
+ */
+
+#ifndef _PINNING_H
+#define _PINNING_H
+
+#include "vm.h"
+
+extern void initPinning();
+extern int framePinned(int);
+extern void unpinPage(Process *, PTE *);
+extern void unpinAll(int);
+
+/* In phase5.c */
+extern void faultIn(void *, int);
+#endif
@@ -0,0 +1,209 @@
+/*
+ *  File:  prefetch.c
+ *
+ *  Description:  This file contains the prefetcher, which brings the
+ *                swapped-out working set of a process back in after the
+ *                process is switched back in
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "prefetch.h"
+#include "swap.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int NumPages;
+extern int FramesMutex;
+
+/*
+ * p1_switch cannot block, so it only marks a process whose working set
+ * has pages on disk when it is switched in. The prefetcher looks for
+ * marked processes on every clock interrupt, whether or not they have
+ * faulted since, and reads up to PREFETCH_PAGES of those pages into free
+ * frames in page order. Pages in blocks that follow each other on disk are
+ * read in one request. A page being prefetched is marked loading, and a
+ * fault on it is retried until it is in.
+ */
+static int PrefetcherPID = EMPTY;
+static int PrefetchDoneSem; // V'd by the prefetcher when it quits
+static int PrefetchQuit;
+
+static int Prefetcher(char *);
+static void prefetchSet(int);
+static int inWorkingSet(Process *, PTE *);
+
+/*
+ *  Start the prefetcher, if enabled
+ */
+void initPrefetch()
+{
+    PrefetcherPID = EMPTY;
+    if (!SwitchPrefetch)
+    {
+        return;
+    }
+    PrefetchDoneSem = semcreateReal(0);
+    PrefetchQuit = FALSE;
+    PrefetcherPID = fork1("Prefetcher", Prefetcher, NULL, USLOSS_MIN_STACK, PREFETCHER_PRIORITY);
+    if (PrefetcherPID < 0)
+    {
+        USLOSS_Console("initPrefetch(): Can't create the prefetcher.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ *  Stop the prefetcher. Must be called before the MMU is turned off.
+ */
+void stopPrefetch()
+{
+    if (PrefetcherPID == EMPTY)
+    {
+        return;
+    }
+    PrefetchQuit = TRUE;
+    sempReal(PrefetchDoneSem);
+    zap(PrefetcherPID);  // the caller may not quit before its child does
+    semfreeReal(PrefetchDoneSem);
+    PrefetcherPID = EMPTY;
+}
+
+/*
+ *  Returns whether a page in the working set of the process with the given
+ *  pid is on disk. Called by p1_switch, so it must not block.
+ */
+int workingSetSwapped(int pid)
+{
+    if (PrefetcherPID == EMPTY)
+    {
+        return FALSE;
+    }
+    Process *proc = getProc(pid);
+    for (int i = 0; i < NumPages; i++)
+    {
+        if (inWorkingSet(proc, &proc->pageTable[i]))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ *  Called by the process with the given pid when it quits. Stops new
+ *  prefetches of its pages and waits for those in progress to finish.
+ */
+void waitPrefetch(int pid)
+{
+    Process *proc = getProc(pid);
+    lockMutex(FramesMutex);
+    proc->quitting = TRUE;
+    while (proc->prefetching > 0)
+    {
+        unlockMutex(FramesMutex);
+        int status;
+        waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+        lockMutex(FramesMutex);
+    }
+    unlockMutex(FramesMutex);
+}
+
+/*
+ *  Kernel process that prefetches the working sets of the processes
+ *  marked when they were switched in
+ */
+static int Prefetcher(char *arg)
+{
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("Prefetcher(): called.\n");
+    }
+    while (!PrefetchQuit)
+    {
+        int status;
+        waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+        for (int i = 0; i < MAXPROC && !PrefetchQuit; i++)
+        {
+            Process *proc = getProc(i);
+            if (proc->wantPrefetch)
+            {
+                proc->wantPrefetch = FALSE;
+                prefetchSet(i);
+            }
+        }
+    }
+    semvReal(PrefetchDoneSem);
+    return 0;
+}
+
+/*
+ *  Prefetch up to PREFETCH_PAGES swapped-out pages of the working set of
+ *  the process in the given slot of the process table
+ */
+static void prefetchSet(int slot)
+{
+    Process *proc = getProc(slot);
+    int pid = proc->pid;
+    if (pid == EMPTY)
+    {
+        return;
+    }
+    int pages[PREFETCH_PAGES];
+    PTE *ptes[PREFETCH_PAGES];
+    int chosen = 0;
+    lockMutex(FramesMutex);
+    for (int i = 0; i < NumPages && chosen < PREFETCH_PAGES; i++)
+    {
+        if (inWorkingSet(proc, &proc->pageTable[i]))
+        {
+            pages[chosen] = i;
+            ptes[chosen] = &proc->pageTable[i];
+            chosen++;
+        }
+    }
+    unlockMutex(FramesMutex);
+
+    // Read each run of pages in consecutive blocks in one request, then
+    // load its pages from the read-ahead buffer
+    int count = 0;
+    for (int i = 0; i < chosen; )
+    {
+        int block;
+        int run = swapRun(ptes + i, chosen - i, &block);
+        if (run > 1)
+        {
+            swapReadRun(block, run);
+        }
+        run = run > 1 ? run : 1;
+        for (int j = i; j < i + run; j++)
+        {
+            count += prefetchPage(pid, pages[j]);
+        }
+        i += run;
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("prefetchSet(): Prefetched %d pages for pid %d.\n", count, pid);
+    }
+}
+
+/*
+ *  Returns whether the given page of the given process is on disk and was
+ *  referenced within the working set window
+ */
+static int inWorkingSet(Process *proc, PTE *pte)
+{
+    return pte->state == ONDISK && pte->segment == EMPTY && !pte->loading &&
+            proc->virtualTime - pte->lastRef <= WorkingSetWindow;
+}
@@ -0,0 +1,15 @@
+/*
+ * prefetch.h
+ */
+
+#ifndef _PREFETCH_H
+#define _PREFETCH_H
+
+extern void initPrefetch();
+extern void stopPrefetch();
+extern int workingSetSwapped(int);
+extern void waitPrefetch(int);
+
+/* In phase5.c */
+extern int prefetchPage(int, int);
+#endif
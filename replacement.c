@@ -0,0 +1,634 @@
+/*
+ *  File:  replacement.c
+ *
+ *  Description:  This file contains the page replacement policies used to
+ *                choose the frame for an incoming page
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "replacement.h"
+#include "pinning.h"
+#include "vm.h"
+
+extern int NextCheckedFrame;
+extern Frame *FrameTable;
+extern int NumFrames;
+extern int NumPages;
+
+/*
+ * A page that was recently replaced under CAR. Only the identity of the page
+ * is remembered, not its contents.
+ */
+typedef struct Ghost
+{
+    int pid;        // The proc that owned the page
+    int page;       // The page that was replaced
+} Ghost;
+
+/*
+ * CAR state. The ghost lists are ordered oldest first and each hold at most
+ * NumFrames entries. CarTarget is the adaptive target size of T1.
+ */
+static Ghost *RecentGhosts;     // B1: pages replaced from T1
+static int NumRecentGhosts = 0;
+static Ghost *FrequentGhosts;   // B2: pages replaced from T2
+static int NumFrequentGhosts = 0;
+static int CarTarget = 0;
+static int RecentSize = 0;      // |T1|
+static int FrequentSize = 0;    // |T2|
+static int RecentHand = 0;
+static int FrequentHand = 0;
+
+/*
+ * Candidates[i] is TRUE if frame i may be replaced for the current fault.
+ * Resident[i] is the number of frames held by the proc in ProcTable[i].
+ * Both are filled in by getNextFrame.
+ */
+static int *Candidates;
+static int Resident[MAXPROC];
+
+static int clockFrame();
+static int carFrame();
+static int wsClockFrame();
+static void carLoaded(int, int, int);
+static void countResident();
+static void chooseCandidates(int);
+
+/*
+ *  Initialize the replacement policy state for the given number of frames
+ */
+void initReplacement(int frames)
+{
+    RecentGhosts = malloc(frames * sizeof(Ghost));
+    FrequentGhosts = malloc(frames * sizeof(Ghost));
+    Candidates = malloc(frames * sizeof(int));
+    if (RecentGhosts == NULL || FrequentGhosts == NULL || Candidates == NULL)
+    {
+        USLOSS_Console("initReplacement(): Could not malloc ghost lists.\n");
+        USLOSS_Halt(1);
+    }
+    NumRecentGhosts = 0;
+    NumFrequentGhosts = 0;
+    CarTarget = 0;
+    RecentSize = 0;
+    FrequentSize = 0;
+    RecentHand = 0;
+    FrequentHand = 0;
+    NextCheckedFrame = 0;
+}
+
+/*
+ *  Free the replacement policy state
+ */
+void destroyReplacement()
+{
+    free(RecentGhosts);
+    free(FrequentGhosts);
+    free(Candidates);
+}
+
+/*
+ *  The function that determines the frame to use in the frame table for a
+ *  fault by the proc with the given pid.
+ *  Return an empty frame if availabe; use the replacement policy otherwise
+ */
+int getNextFrame(int pid)
+{
+    countResident();
+
+    // Search for a free frame, unless the proc is at its cap or the free
+    // frames are all owed to other procs' reservations
+    if (Resident[pid % MAXPROC] < getProc(pid)->maxFrames)
+    {
+        int owed = 0;
+        for (int i = 0; i < MAXPROC; i++)
+        {
+            Process *other = getProc(i);
+            if (other->pid != EMPTY && other->pid != pid && Resident[i] < other->minFrames)
+            {
+                owed += other->minFrames - Resident[i];
+            }
+        }
+        int freeFrame = EMPTY;
+        int numFree = 0;
+        for (int i = 0; i < NumFrames; i++)
+        {
+            if (FrameTable[i].page == EMPTY && !FrameTable[i].locked)
+            {
+                freeFrame = freeFrame == EMPTY ? i : freeFrame;
+                numFree++;
+            }
+        }
+        if (numFree > owed)
+        {
+            return freeFrame;
+        }
+    }
+
+    // If there isn't one then use the replacement policy to replace a page
+    chooseCandidates(pid);
+    if (ReplacementPolicy == POLICY_CAR)
+    {
+        return carFrame();
+    }
+    else if (ReplacementPolicy == POLICY_WSCLOCK)
+    {
+        return wsClockFrame();
+    }
+    return clockFrame();
+}
+
+/*
+ *  Update the target resident set size of the proc with the given pid from
+ *  the time since its previous fault. Called by the pager for every fault.
+ */
+void adjustTarget(int pid)
+{
+    Process *proc = getProc(pid);
+    int interval = proc->virtualTime - proc->lastFault;
+    proc->lastFault = proc->virtualTime;
+    proc->faults++;
+    if (FrameAllocation != ALLOC_PFF)
+    {
+        return;
+    }
+
+    if (interval < PFF_GROW && proc->targetFrames < proc->maxFrames)
+    {
+        proc->targetFrames++;
+        lockMutex(vmStatsMutex);
+        vmStats.targetGrows++;
+        unlockMutex(vmStatsMutex);
+    }
+    else if (interval > PFF_SHRINK && proc->targetFrames > 1 &&
+            proc->targetFrames > proc->minFrames)
+    {
+        proc->targetFrames--;
+        lockMutex(vmStatsMutex);
+        vmStats.targetShrinks++;
+        unlockMutex(vmStatsMutex);
+    }
+    if (proc->targetFrames < proc->minFrames)
+    {
+        proc->targetFrames = proc->minFrames;
+    }
+}
+
+/*
+ *  Record that the given page of the given proc was just loaded into frame.
+ *  Must be called with the frames mutex held.
+ */
+void frameLoaded(int frame, int pid, int page)
+{
+    Process *proc = getProc(pid);
+    proc->pageTable[page].lastRef = proc->virtualTime;
+
+    // A page before a page advised to be used sequentially will not be
+    // used again soon, so it is the next to go
+    PTE *behind = page > 0 ? &proc->pageTable[page - 1] : NULL;
+    if (behind != NULL && proc->pageTable[page].advice == VM_ADV_SEQUENTIAL &&
+            behind->frame != EMPTY && !behind->cow && behind->segment == EMPTY)
+    {
+        setFrameAccess(behind->frame, getFrameAccess(behind->frame) & ~USLOSS_MMU_REF);
+        FrameTable[behind->frame].warm = FALSE;
+        behind->lastRef = 0;
+    }
+    setFrameList(frame, CAR_T1);
+    FrameTable[frame].warm = FALSE;
+    if (ReplacementPolicy == POLICY_CAR)
+    {
+        carLoaded(frame, pid, page);
+    }
+}
+
+/*
+ *  Move the given frame onto the given CAR list, or off the lists if the
+ *  list is EMPTY. Must be called with the frames mutex held.
+ */
+void setFrameList(int frame, int list)
+{
+    int old = FrameTable[frame].list;
+    RecentSize -= old == CAR_T1;
+    FrequentSize -= old == CAR_T2;
+    RecentSize += list == CAR_T1;
+    FrequentSize += list == CAR_T2;
+    FrameTable[frame].list = list;
+}
+
+/*
+ *  Forget the replacement history of the proc with the given pid
+ */
+void forgetProcess(int pid)
+{
+    Ghost *lists[] = {RecentGhosts, FrequentGhosts};
+    int *counts[] = {&NumRecentGhosts, &NumFrequentGhosts};
+    for (int l = 0; l < 2; l++)
+    {
+        int kept = 0;
+        for (int i = 0; i < *counts[l]; i++)
+        {
+            if (lists[l][i].pid != pid)
+            {
+                lists[l][kept++] = lists[l][i];
+            }
+        }
+        *counts[l] = kept;
+    }
+}
+
+/*
+ *  Fold the reference bits of the resident pages of the proc with the given
+ *  pid into their last reference times. Called when the proc is switched out,
+ *  so the bits only reflect references made by that proc.
+ */
+void sampleReferences(int pid)
+{
+    Process *proc = getProc(pid);
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        if (pte->state != INMEM || pte->frame == EMPTY)
+        {
+            continue;
+        }
+        int access = getFrameAccess(pte->frame);
+        if (access & USLOSS_MMU_REF)
+        {
+            pte->lastRef = proc->virtualTime;
+
+            // WSClock owns the bits; the other policies still need them
+            if (ReplacementPolicy == POLICY_WSCLOCK)
+            {
+                setFrameAccess(pte->frame, access & ~USLOSS_MMU_REF);
+            }
+        }
+    }
+}
+
+/*
+ *  Return the number of pages of the proc with the given pid that were
+ *  referenced within the working set window, whether resident or not
+ */
+int workingSetSize(int pid)
+{
+    Process *proc = getProc(pid);
+    int size = 0;
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        if (pte->state == UNUSED)
+        {
+            continue;
+        }
+        if (proc->virtualTime - pte->lastRef <= WorkingSetWindow ||
+                (pte->frame != EMPTY && (getFrameAccess(pte->frame) & USLOSS_MMU_REF)))
+        {
+            size++;
+        }
+    }
+    return size;
+}
+
+/*
+ *  Count the frames held by each proc
+ */
+static void countResident()
+{
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Resident[i] = 0;
+    }
+    for (int i = 0; i < NumFrames; i++)
+    {
+        if (FrameTable[i].page != EMPTY)
+        {
+            Resident[FrameTable[i].pid % MAXPROC]++;
+        }
+    }
+}
+
+/*
+ *  Return whether the frame may be taken from its owner for a fault by the
+ *  proc with the given pid. A proc at its cap may only replace its own pages,
+ *  and frames within another proc's reservation are never taken.
+ */
+static int mayReplace(int frame, int pid)
+{
+    if (FrameTable[frame].locked || FrameTable[frame].page == EMPTY || framePinned(frame))
+    {
+        return FALSE;
+    }
+    if (Resident[pid % MAXPROC] >= getProc(pid)->maxFrames)
+    {
+        return FrameTable[frame].pid == pid;
+    }
+    Process *owner = getProc(FrameTable[frame].pid);
+    return owner->pid == pid || Resident[owner->pid % MAXPROC] > owner->minFrames;
+}
+
+/*
+ *  Fill in Candidates with the frames that may be replaced for a fault by
+ *  the proc with the given pid. Under PFF a proc at or over its target
+ *  replaces its own pages, and any other proc takes frames from procs over
+ *  their targets. If that leaves nothing, every frame allowed by the limits
+ *  is a candidate.
+ */
+static void chooseCandidates(int pid)
+{
+    Process *proc = getProc(pid);
+    int found = FALSE;
+    for (int i = 0; i < NumFrames; i++)
+    {
+        Candidates[i] = FALSE;
+        if (!mayReplace(i, pid))
+        {
+            continue;
+        }
+        if (FrameAllocation == ALLOC_PFF)
+        {
+            Process *owner = getProc(FrameTable[i].pid);
+            if (Resident[pid % MAXPROC] >= proc->targetFrames)
+            {
+                Candidates[i] = FrameTable[i].pid == pid;
+            }
+            else
+            {
+                Candidates[i] = Resident[owner->pid % MAXPROC] > owner->targetFrames;
+            }
+        }
+        else
+        {
+            Candidates[i] = TRUE;
+        }
+        found = found || Candidates[i];
+    }
+
+    if (!found)
+    {
+        for (int i = 0; i < NumFrames; i++)
+        {
+            Candidates[i] = mayReplace(i, pid);
+        }
+    }
+}
+
+/*
+ *  Use the clock algorithm to choose a frame to replace
+ */
+static int clockFrame()
+{
+    for (int i = 0; i < NumFrames + 1; i++)
+    {
+        int index = (NextCheckedFrame + i) % NumFrames;
+        if (!Candidates[index])
+        {
+            continue;
+        }
+        int access = getFrameAccess(index);
+        if (access & USLOSS_MMU_REF)
+        {
+            setFrameAccess(index, access & ~USLOSS_MMU_REF);
+        }
+        else
+        {
+            NextCheckedFrame = (index + 1) % NumFrames;
+            return index;
+        }
+    }
+
+    return EMPTY;
+}
+
+/*
+ *  Use WSClock to choose a frame to replace. Referenced pages are aged as the
+ *  hand passes. The first clean page outside its owner's working set is
+ *  replaced; failing that, the first dirty one, and failing that, the first
+ *  unreferenced page the hand found.
+ */
+static int wsClockFrame()
+{
+    int oldDirty = EMPTY;
+    int unreferenced = EMPTY;
+    for (int i = 0; i < NumFrames + 1; i++)
+    {
+        int index = (NextCheckedFrame + i) % NumFrames;
+        if (!Candidates[index])
+        {
+            continue;
+        }
+        Process *owner = getProc(FrameTable[index].pid);
+        PTE *pte = &owner->pageTable[FrameTable[index].page];
+        int access = getFrameAccess(index);
+        if (access & USLOSS_MMU_REF)
+        {
+            setFrameAccess(index, access & ~USLOSS_MMU_REF);
+            pte->lastRef = owner->virtualTime;
+            continue;
+        }
+
+        if (unreferenced == EMPTY)
+        {
+            unreferenced = index;
+        }
+        if (owner->virtualTime - pte->lastRef > WorkingSetWindow)
+        {
+            if (!(access & USLOSS_MMU_DIRTY))
+            {
+                NextCheckedFrame = (index + 1) % NumFrames;
+                return index;
+            }
+            if (oldDirty == EMPTY)
+            {
+                oldDirty = index;
+            }
+        }
+    }
+
+    int frame = oldDirty != EMPTY ? oldDirty : unreferenced;
+    if (frame != EMPTY)
+    {
+        NextCheckedFrame = (frame + 1) % NumFrames;
+    }
+    return frame;
+}
+
+/*
+ *  Return the index of the ghost for the given page, or EMPTY if none
+ */
+static int findGhost(Ghost *list, int count, int pid, int page)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (list[i].pid == pid && list[i].page == page)
+        {
+            return i;
+        }
+    }
+    return EMPTY;
+}
+
+/*
+ *  Remove the ghost at the given index
+ */
+static void removeGhost(Ghost *list, int *count, int index)
+{
+    memmove(list + index, list + index + 1, (*count - index - 1) * sizeof(Ghost));
+    (*count)--;
+}
+
+/*
+ *  Append a ghost for the given page, dropping the oldest one if the list is full
+ */
+static void addGhost(Ghost *list, int *count, int pid, int page)
+{
+    if (*count == NumFrames)
+    {
+        removeGhost(list, count, 0);
+    }
+    list[*count].pid = pid;
+    list[*count].page = page;
+    (*count)++;
+}
+
+/*
+ *  Advance the given hand to the next candidate frame on the given list.
+ *  Returns the frame, or EMPTY if the list has no candidate frames.
+ */
+static int nextOnList(int list, int *hand)
+{
+    for (int i = 0; i < NumFrames; i++)
+    {
+        int index = (*hand + i) % NumFrames;
+        if (FrameTable[index].page != EMPTY && FrameTable[index].list == list &&
+                Candidates[index])
+        {
+            *hand = (index + 1) % NumFrames;
+            return index;
+        }
+    }
+    return EMPTY;
+}
+
+/*
+ *  Use CAR (clock with adaptive replacement) to choose a frame to replace.
+ *  T1 holds pages seen in a single sweep, T2 holds pages referenced across
+ *  sweeps. A page must be found referenced by two T1 sweeps before it is
+ *  promoted, so one pass through a large region only cycles through T1.
+ */
+static int carFrame()
+{
+    for (int i = 0; i < 3 * NumFrames + 1; i++)
+    {
+        int target = CarTarget > 1 ? CarTarget : 1;
+        int list = RecentSize >= target ? CAR_T1 : CAR_T2;
+        int *hand = list == CAR_T1 ? &RecentHand : &FrequentHand;
+        int frame = nextOnList(list, hand);
+        if (frame == EMPTY)
+        {
+            // The preferred list has nothing to give; use the other one
+            list = list == CAR_T1 ? CAR_T2 : CAR_T1;
+            hand = list == CAR_T1 ? &RecentHand : &FrequentHand;
+            frame = nextOnList(list, hand);
+            if (frame == EMPTY)
+            {
+                return EMPTY;
+            }
+        }
+
+        int access = getFrameAccess(frame);
+        if (access & USLOSS_MMU_REF)
+        {
+            setFrameAccess(frame, access & ~USLOSS_MMU_REF);
+            if (list == CAR_T1)
+            {
+                if (FrameTable[frame].warm)
+                {
+                    setFrameList(frame, CAR_T2);
+                }
+                FrameTable[frame].warm = TRUE;
+            }
+            continue;
+        }
+
+        // Replace this page and remember it in the matching ghost list
+        if (list == CAR_T1)
+        {
+            addGhost(RecentGhosts, &NumRecentGhosts, FrameTable[frame].pid, FrameTable[frame].page);
+        }
+        else
+        {
+            addGhost(FrequentGhosts, &NumFrequentGhosts, FrameTable[frame].pid, FrameTable[frame].page);
+        }
+        setFrameList(frame, EMPTY);
+        return frame;
+    }
+
+    return EMPTY;
+}
+
+/*
+ *  Place a newly loaded page on a CAR list, adapting the T1 target if the
+ *  page was found in a ghost list
+ */
+static void carLoaded(int frame, int pid, int page)
+{
+    int recent = findGhost(RecentGhosts, NumRecentGhosts, pid, page);
+    int frequent = findGhost(FrequentGhosts, NumFrequentGhosts, pid, page);
+    if (recent != EMPTY)
+    {
+        // T1 was too small to keep this page; favor recency
+        int delta = NumFrequentGhosts / NumRecentGhosts;
+        CarTarget += delta > 1 ? delta : 1;
+        if (CarTarget > NumFrames)
+        {
+            CarTarget = NumFrames;
+        }
+        removeGhost(RecentGhosts, &NumRecentGhosts, recent);
+        setFrameList(frame, CAR_T2);
+    }
+    else if (frequent != EMPTY)
+    {
+        // T2 was too small to keep this page; favor frequency
+        int delta = NumRecentGhosts / NumFrequentGhosts;
+        CarTarget -= delta > 1 ? delta : 1;
+        if (CarTarget < 0)
+        {
+            CarTarget = 0;
+        }
+        removeGhost(FrequentGhosts, &NumFrequentGhosts, frequent);
+        setFrameList(frame, CAR_T2);
+    }
+    else
+    {
+        // Keep the history bounded: |T1| + |B1| <= c and the total <= 2c
+        int resident = RecentSize + FrequentSize;
+        if (RecentSize + NumRecentGhosts >= NumFrames && NumRecentGhosts > 0)
+        {
+            removeGhost(RecentGhosts, &NumRecentGhosts, 0);
+        }
+        else if (resident + NumRecentGhosts + NumFrequentGhosts >= 2 * NumFrames &&
+                NumFrequentGhosts > 0)
+        {
+            removeGhost(FrequentGhosts, &NumFrequentGhosts, 0);
+        }
+    }
+
+    if (recent != EMPTY || frequent != EMPTY)
+    {
+        lockMutex(vmStatsMutex);
+        vmStats.ghostHits++;
+        unlockMutex(vmStatsMutex);
+    }
+
+    // The pager's copy referenced the page; the first real reference comes next
+    setFrameAccess(frame, getFrameAccess(frame) & ~USLOSS_MMU_REF);
+}
@@ -0,0 +1,17 @@
+/*
+ * replacement.h
+ */
+
+#ifndef _REPLACEMENT_H
+#define _REPLACEMENT_H
+
+extern void initReplacement(int);
+extern void destroyReplacement();
+extern int getNextFrame(int);
+extern void adjustTarget(int);
+extern void frameLoaded(int, int, int);
+extern void setFrameList(int, int);
+extern void forgetProcess(int);
+extern void sampleReferences(int);
+extern int workingSetSize(int);
+#endif
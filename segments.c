@@ -0,0 +1,544 @@
+/*
+ *  File:  segments.c
+ *
+ *  Description:  This file contains the shared memory segments, which
+ *                are attached into the VM regions of several processes
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "segments.h"
+#include "pinning.h"
+#include "replacement.h"
+#include "swap.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int VMInitialized;
+extern Frame *FrameTable;
+extern int NumPages;
+extern int FramesMutex;
+
+/*
+ * A segment page that is in memory is kept in one frame, which every
+ * process attached to the segment maps read-write. Like any other frame its
+ * pid and page name a single attached page, the keeper.
+ */
+static Segment Segments[MAXSEGMENTS];
+
+static void detach(int, int, int);
+static void destroySegment(int);
+static int findView(int, int, int *, int *);
+
+/*
+ *  Initialize the segment table
+ */
+void initSegments()
+{
+    for (int i = 0; i < MAXSEGMENTS; i++)
+    {
+        Segments[i].name[0] = '\0';
+        Segments[i].pages = 0;
+        Segments[i].attached = 0;
+        Segments[i].pageTable = NULL;
+    }
+}
+
+/*
+ *  Free the page tables of any segments that are left
+ */
+void destroySegments()
+{
+    for (int i = 0; i < MAXSEGMENTS; i++)
+    {
+        free(Segments[i].pageTable);
+        Segments[i].pageTable = NULL;
+        Segments[i].name[0] = '\0';
+    }
+}
+
+/*
+ *  Return the page table of the given segment and set its size in pages,
+ *  or return NULL if there is no such segment
+ */
+PTE *segmentPageTable(int id, int *pages)
+{
+    *pages = Segments[id].pages;
+    return Segments[id].name[0] == '\0' ? NULL : Segments[id].pageTable;
+}
+
+/*
+ *  Return the page table entry that says where the page of the given entry
+ *  is kept: the segment's own entry for an attached page, the given entry
+ *  otherwise
+ */
+PTE *homePTE(PTE *pte)
+{
+    if (pte->segment == EMPTY)
+    {
+        return pte;
+    }
+    return &Segments[pte->segment].pageTable[pte->segmentPage];
+}
+
+/*
+ *  Called when the segment page attached at the given entry has been loaded
+ *  into the given frame. Every attached process maps the frame.
+ */
+void segmentLoaded(PTE *view, int frame)
+{
+    PTE *home = homePTE(view);
+    home->state = INMEM;
+    home->frame = frame;
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        for (int j = 0; proc->pid != EMPTY && j < NumPages; j++)
+        {
+            PTE *pte = &proc->pageTable[j];
+            if (pte->segment == view->segment && pte->segmentPage == view->segmentPage)
+            {
+                pte->state = INMEM;
+                pte->frame = frame;
+            }
+        }
+    }
+}
+
+/*
+ *  Called when the segment page attached at the given entry has been
+ *  evicted. No attached process maps it any more.
+ */
+void segmentEvicted(PTE *view)
+{
+    PTE *home = homePTE(view);
+    home->state = ONDISK;
+    home->frame = EMPTY;
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        for (int j = 0; proc->pid != EMPTY && j < NumPages; j++)
+        {
+            PTE *pte = &proc->pageTable[j];
+            if (pte->segment == view->segment && pte->segmentPage == view->segmentPage)
+            {
+                pte->state = ONDISK;
+                pte->frame = EMPTY;
+            }
+        }
+    }
+}
+
+/*
+ *  Called before the segment page attached at the given entry is written
+ *  out. No attached process maps it while it is written, and the segment
+ *  keeps its frame so that a fault on it waits until segmentEvicted.
+ */
+void hideSegmentPage(PTE *view)
+{
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        for (int j = 0; proc->pid != EMPTY && j < NumPages; j++)
+        {
+            PTE *pte = &proc->pageTable[j];
+            if (pte->segment == view->segment && pte->segmentPage == view->segmentPage)
+            {
+                pte->state = ONDISK;
+                pte->frame = EMPTY;
+            }
+        }
+    }
+}
+
+/*
+ *  Detach every segment from the process with the given pid. Called when
+ *  the process quits, after its mappings are unloaded.
+ */
+void detachSegments(int pid)
+{
+    Process *proc = getProc(pid);
+    lockMutex(FramesMutex);
+    for (int i = 0; i < NumPages; i++)
+    {
+        if (proc->pageTable[i].segment != EMPTY)
+        {
+            detach(pid, proc->pageTable[i].segment, FALSE);
+        }
+    }
+    unlockMutex(FramesMutex);
+}
+
+/*
+ *  Attach every segment the parent process is attached to to the child
+ *  process, at the same pages. Must be called with the frames mutex held.
+ */
+void inheritSegments(int parent, int child)
+{
+    int inherited[MAXSEGMENTS];
+    for (int i = 0; i < MAXSEGMENTS; i++)
+    {
+        inherited[i] = FALSE;
+    }
+
+    Process *parentProc = getProc(parent);
+    Process *childProc = getProc(child);
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *from = &parentProc->pageTable[i];
+        PTE *to = &childProc->pageTable[i];
+        if (from->segment == EMPTY)
+        {
+            continue;
+        }
+        to->segment = from->segment;
+        to->segmentPage = from->segmentPage;
+        to->state = from->state;
+        to->frame = from->frame;
+        inherited[from->segment] = TRUE;
+    }
+    for (int i = 0; i < MAXSEGMENTS; i++)
+    {
+        if (inherited[i])
+        {
+            Segments[i].attached++;
+        }
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmShmCreateReal --
+ *
+ * Called by vmShmCreate.
+ * Creates a shared segment with the given name and number of pages. If
+ * a segment with the name exists and has that many pages, it is returned
+ * instead. A segment lasts until the last process attached to it
+ * detaches.
+ *
+ * Results:
+ *      The id of the segment, or -1 if the arguments are invalid or
+ *      there are no free segments.
+ *
+ * Side effects:
+ *      None until the segment is attached.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmShmCreateReal(char *name, int pages)
+{
+    CheckMode();
+
+    if (!VMInitialized || name == NULL || name[0] == '\0' ||
+            strlen(name) >= SEGMENT_NAME_LEN || pages < 1 || pages > NumPages)
+    {
+        return -1;
+    }
+
+    lockMutex(FramesMutex);
+    int id = EMPTY;
+    for (int i = 0; i < MAXSEGMENTS; i++)
+    {
+        if (strcmp(Segments[i].name, name) == 0)
+        {
+            unlockMutex(FramesMutex);
+            return Segments[i].pages == pages ? i : -1;
+        }
+        if (Segments[i].name[0] == '\0' && id == EMPTY)
+        {
+            id = i;
+        }
+    }
+    if (id == EMPTY)
+    {
+        unlockMutex(FramesMutex);
+        return -1;
+    }
+
+    Segment *segment = &Segments[id];
+    segment->pageTable = malloc(pages * sizeof(PTE));
+    if (segment->pageTable == NULL)
+    {
+        USLOSS_Console("vmShmCreateReal(): Could not malloc a segment page table.\n");
+        USLOSS_Halt(1);
+    }
+    for (int i = 0; i < pages; i++)
+    {
+        PTE *pte = &segment->pageTable[i];
+        pte->state = UNUSED;
+        pte->frame = EMPTY;
+        pte->diskBlock = EMPTY;
+        pte->diskSector = 0;
+        pte->diskSectors = 0;
+        pte->lastRef = 0;
+        pte->cow = FALSE;
+        pte->segment = EMPTY;
+        pte->segmentPage = 0;
+        pte->mapUnit = EMPTY;
+        pte->mapSector = 0;
+        pte->loading = FALSE;
+        pte->advice = VM_ADV_NORMAL;
+        pte->pinned = FALSE;
+    }
+    strcpy(segment->name, name);
+    segment->pages = pages;
+    segment->attached = 0;
+    unlockMutex(FramesMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmShmCreateReal(): Created segment %d \"%s\" of %d pages.\n", id, name, pages);
+    }
+    return id;
+} /* vmShmCreateReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmShmAttachReal --
+ *
+ * Called by vmShmAttach.
+ * Attaches the given segment to the current process at the given
+ * page-aligned address of its VM region. The pages it covers must not
+ * have been used yet.
+ *
+ * Results:
+ *      0 on success, -1 if the arguments are invalid.
+ *
+ * Side effects:
+ *      Pages of the segment that are in memory are mapped right away.
+ *      Pages that are still being loaded or evicted are faulted in.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmShmAttachReal(int id, void *addr)
+{
+    CheckMode();
+
+    if (!VMInitialized || id < 0 || id >= MAXSEGMENTS || Segments[id].name[0] == '\0')
+    {
+        return -1;
+    }
+    int dummy;
+    long offset = (char *) addr - (char *) USLOSS_MmuRegion(&dummy);
+    if (offset < 0 || offset % USLOSS_MmuPageSize() != 0)
+    {
+        return -1;
+    }
+    int start = offset / USLOSS_MmuPageSize();
+    Segment *segment = &Segments[id];
+    if (start + segment->pages > NumPages)
+    {
+        return -1;
+    }
+
+    int pid = getpid();
+    Process *proc = getProc(pid);
+    lockMutex(FramesMutex);
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        int inRange = i >= start && i < start + segment->pages;
+        if (pte->segment == id || (inRange && (pte->state != UNUSED || pte->segment != EMPTY)))
+        {
+            unlockMutex(FramesMutex);
+            return -1;
+        }
+    }
+
+    int pending = FALSE;
+    for (int i = 0; i < segment->pages; i++)
+    {
+        PTE *pte = &proc->pageTable[start + i];
+        PTE *home = &segment->pageTable[i];
+        pte->segment = id;
+        pte->segmentPage = i;
+        pte->state = home->state;
+        if (home->state == INMEM && (home->loading || FrameTable[home->frame].locked))
+        {
+            // The frame is not ready yet, so the page is faulted in below
+            pending = TRUE;
+        }
+        else if (home->state == INMEM)
+        {
+            // Our mappings are loaded, so map the page now
+            pte->frame = home->frame;
+            int result = USLOSS_MmuMap(TAG, start + i, home->frame, USLOSS_MMU_PROT_RW);
+            if (result != USLOSS_MMU_OK)
+            {
+                USLOSS_Console("vmShmAttachReal(): Could not perform mapping. Error code %d.\n", result);
+                USLOSS_Halt(1);
+            }
+        }
+    }
+    segment->attached++;
+    unlockMutex(FramesMutex);
+
+    for (int i = start; pending && i < start + segment->pages; i++)
+    {
+        if (proc->pageTable[i].frame == EMPTY && proc->pageTable[i].state == INMEM)
+        {
+            faultIn((void *) ((long) i * USLOSS_MmuPageSize()), USLOSS_MMU_FAULT);
+        }
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("vmShmAttachReal(): Attached segment %d to pid %d at page %d.\n", id, pid, start);
+    }
+    return 0;
+} /* vmShmAttachReal */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * vmShmDetachReal --
+ *
+ * Called by vmShmDetach.
+ * Detaches the given segment from the current process.
+ *
+ * Results:
+ *      0 on success, -1 if the segment is not attached.
+ *
+ * Side effects:
+ *      The segment is destroyed if no process is attached any more.
+ *
+ *----------------------------------------------------------------------
+ */
+int vmShmDetachReal(int id)
+{
+    CheckMode();
+
+    if (!VMInitialized || id < 0 || id >= MAXSEGMENTS || Segments[id].name[0] == '\0')
+    {
+        return -1;
+    }
+    int pid = getpid();
+    Process *proc = getProc(pid);
+    lockMutex(FramesMutex);
+    int attached = FALSE;
+    for (int i = 0; i < NumPages && !attached; i++)
+    {
+        attached = proc->pageTable[i].segment == id;
+    }
+    if (attached)
+    {
+        detach(pid, id, TRUE);
+    }
+    unlockMutex(FramesMutex);
+    return attached ? 0 : -1;
+} /* vmShmDetachReal */
+
+/*
+ *  Detach the given segment from the process with the given pid, unmapping
+ *  its pages if the process's mappings are loaded. Frames the process kept
+ *  are handed to another attached process.
+ */
+static void detach(int pid, int id, int mapped)
+{
+    Process *proc = getProc(pid);
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        if (pte->segment != id)
+        {
+            continue;
+        }
+        int frame = pte->frame;
+        int segmentPage = pte->segmentPage;
+        if (frame != EMPTY && mapped)
+        {
+            int result = USLOSS_MmuUnmap(TAG, i);
+            if (result != USLOSS_MMU_OK)
+            {
+                USLOSS_Console("detach(): Could not perform unmapping. Error code %d.\n", result);
+                USLOSS_Halt(1);
+            }
+        }
+        pte->state = UNUSED;
+        pte->frame = EMPTY;
+        pte->segment = EMPTY;
+        pte->segmentPage = 0;
+
+        int keeperPid;
+        int keeperPage;
+        if (frame != EMPTY && FrameTable[frame].pid == pid && FrameTable[frame].page == i &&
+                findView(id, segmentPage, &keeperPid, &keeperPage))
+        {
+            FrameTable[frame].pid = keeperPid;
+            FrameTable[frame].page = keeperPage;
+        }
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("detach(): Detached segment %d from pid %d.\n", id, pid);
+    }
+    if (--Segments[id].attached == 0)
+    {
+        destroySegment(id);
+    }
+}
+
+/*
+ *  Free the frames, swap space and page table of the given segment
+ */
+static void destroySegment(int id)
+{
+    Segment *segment = &Segments[id];
+    for (int i = 0; i < segment->pages; i++)
+    {
+        PTE *home = &segment->pageTable[i];
+        if (home->frame != EMPTY)
+        {
+            FrameTable[home->frame].page = EMPTY;
+            FrameTable[home->frame].pid = EMPTY;
+            setFrameList(home->frame, EMPTY);
+            FrameTable[home->frame].warm = FALSE;
+            setFrameAccess(home->frame, 0);
+        }
+        swapFree(home);
+    }
+    free(segment->pageTable);
+    segment->pageTable = NULL;
+    segment->name[0] = '\0';
+    segment->pages = 0;
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("destroySegment(): Destroyed segment %d.\n", id);
+    }
+}
+
+/*
+ *  Find a process page the given segment page is attached at. Returns FALSE
+ *  if the segment is not attached anywhere.
+ */
+static int findView(int id, int segmentPage, int *pid, int *page)
+{
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        for (int j = 0; proc->pid != EMPTY && j < NumPages; j++)
+        {
+            if (proc->pageTable[j].segment == id && proc->pageTable[j].segmentPage == segmentPage)
+            {
+                *pid = proc->pid;
+                *page = j;
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
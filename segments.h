@@ -0,0 +1,19 @@
+/*
+ * segments.h
+ */
+
+#ifndef _SEGMENTS_H
+#define _SEGMENTS_H
+
+#include "vm.h"
+
+extern void initSegments();
+extern void destroySegments();
+extern PTE *homePTE(PTE *);
+extern PTE *segmentPageTable(int, int *);
+extern void segmentLoaded(PTE *, int);
+extern void segmentEvicted(PTE *);
+extern void hideSegmentPage(PTE *);
+extern void detachSegments(int);
+extern void inheritSegments(int, int);
+#endif
@@ -0,0 +1,587 @@
+/*
+ *  File:  sharing.c
+ *
+ *  Description:  This file contains the bookkeeping for frames that several
+ *                pages share read-only, and the scanner that merges pages
+ *                with identical contents into shared frames
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "pinning.h"
+#include "replacement.h"
+#include "segments.h"
+#include "sharing.h"
+#include "swapCache.h"
+#include "swap.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern Frame *FrameTable;
+extern int NumFrames;
+extern int NumPages;
+extern int FramesMutex;
+extern int ZeroFrame;
+
+/*
+ * A shared frame is mapped read-only by every page that shares it, and its
+ * sharers field counts those pages. The frame's pid and page name one of
+ * them, the keeper, whose swap space holds the disk copy of the frame.
+ * The other sharers have no swap space of their own while they share it.
+ */
+static int MergerPID = EMPTY;
+static int MergeSem;        // V'd by the pagers to run a merging pass
+static int MergeDoneSem;    // V'd by the merger when it quits
+static int MergeQuit;
+static int FaultsSinceMerge;
+static int *Hashes;
+
+static int Merger(char *);
+static void mergePass();
+static int mayMerge(int);
+static int mergeInto(int, int);
+static int findSharer(int, int *, int *);
+static int hashFrame(int);
+static int sameContents(int, int);
+static char *mapFrame(int, int *);
+static void unmapFrame(int);
+
+/*
+ *  Start the page merging scanner, if enabled. Must be called after the
+ *  frame table is set up.
+ */
+void initSharing()
+{
+    MergerPID = EMPTY;
+    if (!PageMerging || NumPages < 2)
+    {
+        return;
+    }
+    Hashes = malloc(NumFrames * sizeof(int));
+    if (Hashes == NULL)
+    {
+        USLOSS_Console("initSharing(): Could not malloc the hash table.\n");
+        USLOSS_Halt(1);
+    }
+    MergeSem = semcreateReal(0);
+    MergeDoneSem = semcreateReal(0);
+    MergeQuit = FALSE;
+    FaultsSinceMerge = 0;
+    MergerPID = fork1("Merger", Merger, NULL, USLOSS_MIN_STACK, MERGER_PRIORITY);
+    if (MergerPID < 0)
+    {
+        USLOSS_Console("initSharing(): Can't create the merger.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ *  Stop the page merging scanner. Must be called before the MMU is turned
+ *  off.
+ */
+void stopSharing()
+{
+    if (MergerPID == EMPTY)
+    {
+        return;
+    }
+    MergeQuit = TRUE;
+    semvReal(MergeSem);
+    sempReal(MergeDoneSem);
+    zap(MergerPID);  // the caller may not quit before its child does
+    semfreeReal(MergeSem);
+    semfreeReal(MergeDoneSem);
+    free(Hashes);
+    MergerPID = EMPTY;
+}
+
+/*
+ *  Called by a pager after each fault. Every MERGE_INTERVAL faults the
+ *  merger is woken for a pass, so merging runs while memory is in demand.
+ */
+void kickMerger()
+{
+    if (MergerPID == EMPTY)
+    {
+        return;
+    }
+    if (++FaultsSinceMerge >= MERGE_INTERVAL)
+    {
+        FaultsSinceMerge = 0;
+        semvReal(MergeSem);
+    }
+}
+
+/*
+ *  Remove the given page from the sharers of the given frame. The page's
+ *  table entry must already point elsewhere. A new keeper takes over the
+ *  disk copy if the keeper left, and a lone remaining sharer gets the frame
+ *  to itself. Must be called with the frames mutex held.
+ */
+void unshareFrame(int frame, int pid, int page)
+{
+    if (frame == ZeroFrame || FrameTable[frame].sharers == 0)
+    {
+        return;
+    }
+    FrameTable[frame].sharers--;
+    int keeperLeft = FrameTable[frame].pid == pid && FrameTable[frame].page == page;
+    if (!keeperLeft && FrameTable[frame].sharers > 1)
+    {
+        return;
+    }
+
+    int sharerPid;
+    int sharerPage;
+    if (!findSharer(frame, &sharerPid, &sharerPage))
+    {
+        FrameTable[frame].sharers = 0;
+        return;
+    }
+    PTE *sharer = &getProc(sharerPid)->pageTable[sharerPage];
+    if (keeperLeft)
+    {
+        swapShare(&getProc(pid)->pageTable[page], sharer);
+        FrameTable[frame].pid = sharerPid;
+        FrameTable[frame].page = sharerPage;
+    }
+    if (FrameTable[frame].sharers == 1)
+    {
+        sharer->cow = FALSE;
+        FrameTable[frame].sharers = 0;
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("unshareFrame(): Frame %d now kept by page %d of pid %d.\n", frame, sharerPage, sharerPid);
+    }
+}
+
+/*
+ *  Called while evicting a shared frame, after the keeper's copy has been
+ *  written. Every other sharer is marked ONDISK and shares the keeper's
+ *  swap space.
+ */
+void evictSharers(int frame, PTE *keeper)
+{
+    if (FrameTable[frame].sharers == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        if (proc->pid == EMPTY)
+        {
+            continue;
+        }
+        for (int j = 0; j < NumPages; j++)
+        {
+            PTE *pte = &proc->pageTable[j];
+            if (pte != keeper && pte->frame == frame && pte->cow)
+            {
+                swapShare(keeper, pte);
+                pte->state = ONDISK;
+                pte->frame = EMPTY;
+                pte->cow = FALSE;
+            }
+        }
+    }
+    FrameTable[frame].sharers = 0;
+}
+
+/*
+ *  Stop every page of the process with the given pid from sharing a frame.
+ *  Called when the process quits.
+ */
+void dropSharedPages(int pid)
+{
+    Process *proc = getProc(pid);
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        if (pte->frame != EMPTY && pte->cow)
+        {
+            int frame = pte->frame;
+            pte->frame = EMPTY;
+            pte->cow = FALSE;
+            unshareFrame(frame, pid, i);
+        }
+    }
+}
+
+/*
+ *  Get the address space of the process with the given pid ready to be
+ *  cloned: wait for the pagers to finish with its frames, and write its
+ *  pages in the swap cache back to disk so they can be shared. Returns
+ *  FALSE if the swap disk is full. Must be called with the frames mutex
+ *  held, and nothing can change the address space again until it is let go.
+ */
+int prepareClone(int parent)
+{
+    Process *parentProc = getProc(parent);
+    int busy = TRUE;
+    while (busy)
+    {
+        busy = FALSE;
+        for (int i = 0; i < NumPages && !busy; i++)
+        {
+            int frame = parentProc->pageTable[i].frame;
+            busy = frame != EMPTY && frame != ZeroFrame && FrameTable[frame].locked;
+        }
+        if (busy)
+        {
+            unlockMutex(FramesMutex);
+            int status;
+            waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+            lockMutex(FramesMutex);
+        }
+    }
+
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *pte = &parentProc->pageTable[i];
+        if (pte->state == ONDISK && pte->segment == EMPTY && pte->mapUnit == EMPTY &&
+                !cacheWriteBack(parent, i))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ *  Give the child process a copy-on-write clone of the parent's address
+ *  space. Resident pages become shared by both, and pages on disk share
+ *  their swap space. Called by vmSpawnReal while the parent is running,
+ *  after prepareClone and with the frames mutex still held.
+ */
+void cloneAddressSpace(int parent, int child)
+{
+    Process *parentProc = getProc(parent);
+    Process *childProc = getProc(child);
+    for (int i = 0; i < NumPages; i++)
+    {
+        PTE *from = &parentProc->pageTable[i];
+        PTE *to = &childProc->pageTable[i];
+        if (from->segment != EMPTY || from->mapUnit != EMPTY || from->state == UNUSED)
+        {
+            continue;
+        }
+
+        if (from->state == ONDISK)
+        {
+            to->state = ONDISK;
+            swapShare(from, to);
+            continue;
+        }
+
+        if (from->frame != ZeroFrame)
+        {
+            if (FrameTable[from->frame].sharers == 0)
+            {
+                // Our page becomes read-only too, starting now. A page
+                // that was prefetched or populated may not be mapped yet.
+                from->cow = TRUE;
+                FrameTable[from->frame].sharers = 1;
+                int mapped;
+                int protection;
+                int result = USLOSS_MMU_OK;
+                if (USLOSS_MmuGetMap(TAG, i, &mapped, &protection) == USLOSS_MMU_OK)
+                {
+                    result = USLOSS_MmuUnmap(TAG, i);
+                    if (result == USLOSS_MMU_OK)
+                    {
+                        result = USLOSS_MmuMap(TAG, i, from->frame, USLOSS_MMU_PROT_READ);
+                    }
+                }
+                if (result != USLOSS_MMU_OK)
+                {
+                    USLOSS_Console("cloneAddressSpace(): Could not remap page %d. Error code %d.\n", i, result);
+                    USLOSS_Halt(1);
+                }
+            }
+            FrameTable[from->frame].sharers++;
+        }
+        to->state = INMEM;
+        to->frame = from->frame;
+        to->cow = TRUE;
+    }
+    inheritSegments(parent, child);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("cloneAddressSpace(): Cloned pid %d into pid %d.\n", parent, child);
+    }
+}
+
+/*
+ *  Kernel process that merges pages with identical contents
+ */
+static int Merger(char *arg)
+{
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("Merger(): called.\n");
+    }
+    while (TRUE)
+    {
+        sempReal(MergeSem);
+        if (MergeQuit)
+        {
+            break;
+        }
+        mergePass();
+    }
+    semvReal(MergeDoneSem);
+    return 0;
+}
+
+/*
+ *  Hash every resident page, then merge each private page into a frame
+ *  with the same contents, preferring the zero frame
+ */
+static void mergePass()
+{
+    lockMutex(FramesMutex);
+    int zeroHash = ZeroFrame != EMPTY ? hashFrame(ZeroFrame) : 0;
+    for (int i = 0; i < NumFrames; i++)
+    {
+        Hashes[i] = mayMerge(i) ? hashFrame(i) : 0;
+    }
+
+    for (int i = 0; i < NumFrames; i++)
+    {
+        if (!mayMerge(i) || FrameTable[i].sharers > 0)
+        {
+            continue;
+        }
+        if (ZeroFrame != EMPTY && Hashes[i] == zeroHash && mergeInto(i, ZeroFrame))
+        {
+            continue;
+        }
+        for (int j = 0; j < NumFrames; j++)
+        {
+            if (j != i && mayMerge(j) && Hashes[j] == Hashes[i] && mergeInto(i, j))
+            {
+                break;
+            }
+        }
+    }
+
+    // Count the frames that sharing saves right now
+    int saved = 0;
+    for (int i = 0; i < NumFrames; i++)
+    {
+        if (FrameTable[i].sharers > 1)
+        {
+            saved += FrameTable[i].sharers - 1;
+        }
+    }
+    for (int i = 0; ZeroFrame != EMPTY && i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        for (int j = 0; proc->pid != EMPTY && j < NumPages; j++)
+        {
+            if (proc->pageTable[j].frame == ZeroFrame)
+            {
+                saved++;
+            }
+        }
+    }
+    unlockMutex(FramesMutex);
+
+    lockMutex(vmStatsMutex);
+    if (saved > vmStats.framesSaved)
+    {
+        vmStats.framesSaved = saved;
+    }
+    unlockMutex(vmStatsMutex);
+}
+
+/*
+ *  Returns TRUE if the page in the given frame may be merged or merged into
+ */
+static int mayMerge(int frame)
+{
+    if (frame == ZeroFrame || FrameTable[frame].locked || FrameTable[frame].page == EMPTY ||
+            framePinned(frame))
+    {
+        return FALSE;
+    }
+    PTE *pte = &getProc(FrameTable[frame].pid)->pageTable[FrameTable[frame].page];
+    return pte->state == INMEM && pte->frame == frame && pte->segment == EMPTY &&
+            pte->mapUnit == EMPTY;
+}
+
+/*
+ *  Map the private page in the source frame to the target frame and free
+ *  the source frame, if the two hold the same contents. The frames are
+ *  compared and the page remapped with interrupts disabled, so neither
+ *  owner can write its page in between. Returns TRUE if it was merged.
+ */
+static int mergeInto(int source, int target)
+{
+    int pid = FrameTable[source].pid;
+    int pageNum = FrameTable[source].page;
+    PTE *pte = &getProc(pid)->pageTable[pageNum];
+
+    // Looking at the frames must not make their pages seem referenced
+    disableInterrupts();
+    int sourceAccess = getFrameAccess(source);
+    int targetAccess = getFrameAccess(target);
+    if (!sameContents(source, target))
+    {
+        setFrameAccess(source, sourceAccess);
+        setFrameAccess(target, targetAccess);
+        enableInterrupts();
+        return FALSE;
+    }
+    setFrameAccess(target, targetAccess);
+
+    if (target != ZeroFrame)
+    {
+        if (FrameTable[target].sharers == 0)
+        {
+            // The keeper's own page becomes read-only as well
+            getProc(FrameTable[target].pid)->pageTable[FrameTable[target].page].cow = TRUE;
+            FrameTable[target].sharers = 1;
+        }
+        FrameTable[target].sharers++;
+    }
+    pte->frame = target;
+    pte->cow = TRUE;
+
+    FrameTable[source].page = EMPTY;
+    FrameTable[source].pid = EMPTY;
+    setFrameList(source, EMPTY);
+    FrameTable[source].warm = FALSE;
+    setFrameAccess(source, 0);
+    enableInterrupts();
+
+    // The keeper's disk copy, or none for the zero frame, stands in for ours
+    swapFree(pte);
+
+    lockMutex(vmStatsMutex);
+    vmStats.pagesMerged++;
+    unlockMutex(vmStatsMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("mergeInto(): Merged page %d of pid %d from frame %d into frame %d.\n", pageNum, pid, source, target);
+    }
+    return TRUE;
+}
+
+/*
+ *  Find a page that shares the given frame. Returns FALSE if there is none.
+ */
+static int findSharer(int frame, int *pid, int *page)
+{
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Process *proc = getProc(i);
+        if (proc->pid == EMPTY)
+        {
+            continue;
+        }
+        for (int j = 0; j < NumPages; j++)
+        {
+            if (proc->pageTable[j].frame == frame && proc->pageTable[j].cow)
+            {
+                *pid = proc->pid;
+                *page = j;
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+/*
+ *  Returns a hash of the contents of the given frame
+ */
+static int hashFrame(int frame)
+{
+    // Looking at the frame must not make its page seem referenced
+    int access = getFrameAccess(frame);
+    disableInterrupts();
+    int pageNum;
+    unsigned char *data = (unsigned char *) mapFrame(frame, &pageNum);
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < USLOSS_MmuPageSize(); i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    unmapFrame(pageNum);
+    enableInterrupts();
+    setFrameAccess(frame, access);
+    return (int) hash;
+}
+
+/*
+ *  Returns TRUE if the two frames hold the same contents. Must be called
+ *  with interrupts disabled.
+ */
+static int sameContents(int first, int second)
+{
+    int firstPage;
+    int secondPage;
+    char *firstData = mapFrame(first, &firstPage);
+    char *secondData = mapFrame(second, &secondPage);
+    int same = memcmp(firstData, secondData, USLOSS_MmuPageSize()) == 0;
+    unmapFrame(secondPage);
+    unmapFrame(firstPage);
+    return same;
+}
+
+/*
+ *  Map the given frame at a page of the VM region that nothing else has
+ *  mapped and return its address. Interrupts must be disabled until the
+ *  page is unmapped, so that no pager can map the same page meanwhile.
+ */
+static char *mapFrame(int frame, int *pageNum)
+{
+    for (int i = 0; i < NumPages; i++)
+    {
+        int mapped;
+        int protection;
+        if (USLOSS_MmuGetMap(TAG, i, &mapped, &protection) == USLOSS_MMU_ERR_NOMAP)
+        {
+            int result = USLOSS_MmuMap(TAG, i, frame, USLOSS_MMU_PROT_READ);
+            if (result != USLOSS_MMU_OK)
+            {
+                USLOSS_Console("mapFrame(): Could not perform mapping. Error code %d.\n", result);
+                USLOSS_Halt(1);
+            }
+            *pageNum = i;
+            return page(i);
+        }
+    }
+    USLOSS_Console("mapFrame(): No page is free to map frame %d.\n", frame);
+    USLOSS_Halt(1);
+    return NULL;
+}
+
+/*
+ *  Undo mapFrame
+ */
+static void unmapFrame(int pageNum)
+{
+    int result = USLOSS_MmuUnmap(TAG, pageNum);
+    if (result != USLOSS_MMU_OK)
+    {
+        USLOSS_Console("unmapFrame(): Could not perform unmapping. Error code %d.\n", result);
+        USLOSS_Halt(1);
+    }
+}
@@ -0,0 +1,18 @@
+/*
+ * sharing.h
+ */
+
+#ifndef _SHARING_H
+#define _SHARING_H
+
+#include "vm.h"
+
+extern void initSharing();
+extern void stopSharing();
+extern void kickMerger();
+extern void unshareFrame(int, int, int);
+extern void evictSharers(int, PTE *);
+extern void dropSharedPages(int);
+extern int prepareClone(int);
+extern void cloneAddressSpace(int, int);
+#endif
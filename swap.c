@@ -0,0 +1,1230 @@
+/*
+ *  File:  swap.c
+ *
+ *  Description:  This file contains the swap disk layout: allocation of
+ *                swap space to pages and the disk I/O for a page
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "compression.h"
+#include "segments.h"
+#include "swap.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int NumPages;
+extern int FramesMutex;
+extern Frame *FrameTable;
+
+/*
+ * BlockMasks[b] has bit s set if sector s of block b is in use. A block
+ * holds one page, or in the compressed format any number of compressed
+ * pages that each occupy a run of sectors. Together with the location kept
+ * in each page table entry this is the index of the swap disk.
+ *
+ * With SwapDisks units, block b is block b / SwapDisks of unit
+ * (SWAPDISK + b % SwapDisks) % USLOSS_DISK_UNITS, so consecutive blocks
+ * alternate between the disks. Each unit contributes as many blocks as
+ * the smallest of them holds.
+ *
+ * RunRefs[b * SectorsPerPage + s] counts the page table entries that share
+ * the run starting at sector s of block b. Pages that were shared in memory
+ * keep sharing one copy on disk until one of them is written again.
+ */
+static int *BlockMasks;
+static int *RunRefs;
+static int NumBlocks = 0;
+static int SectorsPerPage;
+static int SwapMutex;
+static int InFlight[USLOSS_DISK_UNITS]; // # requests outstanding on each unit
+
+/*
+ * The swap I/O scheduler. Each unit serves one request at a time; the
+ * others queue here, one slot per process, and the request that finishes
+ * dispatches the next in C-SCAN order from the track it left the head on.
+ * HeadTrack is also used to measure seek distance when the scheduler is
+ * off. It only accounts for swap I/O.
+ */
+typedef struct IORequest
+{
+    int waiting;    // Whether the slot holds a queued request
+    int unit;       // Disk unit of the request
+    int track;      // First track of the request
+    int read;       // Whether the request is a read
+    int arrived;    // Time the request was queued
+    int sem;        // Semaphore the requester blocks on
+} IORequest;
+
+static IORequest Requests[MAXPROC];
+static int Busy[USLOSS_DISK_UNITS];
+static int HeadTrack[USLOSS_DISK_UNITS];
+
+/*
+ * The log-structured layout. Every write goes to a new run at the log
+ * head, packed into the head block and then the next free block after it.
+ * The page table entries are the map from each page to its current run.
+ * Blocks of the segment being cleaned are not handed out, so a run the
+ * cleaner is copying cannot be reused underneath it.
+ */
+static int LogBlock;        // Block at the log head, EMPTY if none yet
+static int LogSector;       // Next free sector of the head block
+static int CleaningSegment; // Log segment being cleaned, EMPTY if none
+static int CleanerPID;
+static int CleanSem;
+static int CleanDoneSem;
+static int CleanQuit;
+static int CleanPending;    // Whether the cleaner has been woken
+
+/*
+ * Extents. Extent x is local extent x / SwapDisks of unit x % SwapDisks and
+ * starts on a track boundary. An extent holds one region of ExtentBlocks
+ * pages of one owner, a process or MAXPROC + id for a segment, and page k
+ * of the region is kept in block k of the extent when it is free, so pages
+ * that are neighbours in memory are neighbours on disk. The read-ahead
+ * buffer holds the blocks of an extent read along with the last miss.
+ */
+static int ExtentBlocks;
+static int NumExtents;
+static int *ExtentOwners;   // Owner of each extent, EMPTY if free
+static int *ExtentRegions;  // Region of its owner each extent holds
+static char *AheadData;
+static int AheadBlock;      // First block in the read-ahead buffer, EMPTY if none
+static int AheadCount;      // # blocks in the read-ahead buffer
+static int Writes;          // # writes started, to spot reads that raced one
+
+/*
+ * Where placePage put a page, and the copy of it to write there
+ */
+typedef struct Placement
+{
+    int block;      // Block of the page's run
+    int sector;     // First sector of the run
+    int sectors;    // # sectors in the run
+    char *source;   // The page, or its compressed copy
+} Placement;
+
+static int placePage(char *, char *, PTE *, int, int, Placement *);
+static int wholeBlock(Placement *);
+static int allocRun(int, int *, int *);
+static int scanRun(int, int, int *, int *);
+static int extentAlloc(int, int, int, int *, int *);
+static int extentBlock(int, int);
+static int blockExtent(int);
+static int extentFree(int);
+static void readBlock(int, int, int, int, char *);
+static int aheadIndex(int);
+static int aheadWindow(int);
+static int logAlloc(int, int *, int *);
+static int freeBlocks();
+static int Cleaner(char *);
+static void cleanPass();
+static int pickSegment();
+static int moveRun(int, int);
+static int forEachOwner(int, int, int, int, int *);
+static int liveSectors(int);
+static void releaseRun(PTE *);
+static void readSectors(int, int, int, char *);
+static void writeSectors(int, int, int, char *);
+static int blockUnit(int);
+static void startIO(int, int, int);
+static void finishIO(int);
+static int nextRequest(int);
+static int seek(int, int);
+static void countSeek(int);
+
+/*
+ *  Initialize the swap disk layout. Must be called after initVmStats.
+ */
+void initSwap()
+{
+    SectorsPerPage = USLOSS_MmuPageSize() / USLOSS_DISK_SECTOR_SIZE;
+    assert(SectorsPerPage < 8 * sizeof(int));
+    NumBlocks = vmStats.diskBlocks;
+    BlockMasks = malloc(NumBlocks * sizeof(int));
+    RunRefs = malloc(NumBlocks * SectorsPerPage * sizeof(int));
+    if (BlockMasks == NULL || RunRefs == NULL)
+    {
+        USLOSS_Console("initSwap(): Could not malloc the block table.\n");
+        USLOSS_Halt(1);
+    }
+    for (int i = 0; i < NumBlocks; i++)
+    {
+        BlockMasks[i] = 0;
+    }
+    for (int i = 0; i < NumBlocks * SectorsPerPage; i++)
+    {
+        RunRefs[i] = 0;
+    }
+    for (int i = 0; i < USLOSS_DISK_UNITS; i++)
+    {
+        InFlight[i] = 0;
+        Busy[i] = FALSE;
+        HeadTrack[i] = 0;
+    }
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        Requests[i].waiting = FALSE;
+        Requests[i].sem = EMPTY;
+        if (SwapScheduler && (Requests[i].sem = semcreateReal(0)) < 0)
+        {
+            USLOSS_Console("initSwap(): Could not create request semaphore.\n");
+            USLOSS_Halt(1);
+        }
+    }
+    SwapMutex = createMutex();
+
+    // One track holds at least one block for extent alignment
+    int blocksPerTrack = USLOSS_DISK_TRACK_SIZE / SectorsPerPage;
+    ExtentBlocks = EXTENT_TRACKS * (blocksPerTrack > 0 ? blocksPerTrack : 1);
+    NumExtents = SwapExtents ? NumBlocks / SwapDisks / ExtentBlocks * SwapDisks : 0;
+    ExtentOwners = malloc(NumExtents * sizeof(int));
+    ExtentRegions = malloc(NumExtents * sizeof(int));
+    AheadData = malloc(READ_AHEAD * USLOSS_MmuPageSize());
+    if ((NumExtents > 0 && (ExtentOwners == NULL || ExtentRegions == NULL)) || AheadData == NULL)
+    {
+        USLOSS_Console("initSwap(): Could not malloc the extent table.\n");
+        USLOSS_Halt(1);
+    }
+    for (int i = 0; i < NumExtents; i++)
+    {
+        ExtentOwners[i] = EMPTY;
+        ExtentRegions[i] = 0;
+    }
+    AheadBlock = EMPTY;
+    AheadCount = 0;
+    Writes = 0;
+
+    LogBlock = EMPTY;
+    LogSector = 0;
+    CleaningSegment = EMPTY;
+    CleanerPID = EMPTY;
+    if (!LogSwap || NumBlocks < 2 * LOG_SEGMENT)
+    {
+        return;
+    }
+    CleanSem = semcreateReal(0);
+    CleanDoneSem = semcreateReal(0);
+    CleanQuit = FALSE;
+    CleanPending = FALSE;
+    CleanerPID = fork1("Cleaner", Cleaner, NULL, USLOSS_MIN_STACK, CLEANER_PRIORITY);
+    if (CleanerPID < 0)
+    {
+        USLOSS_Console("initSwap(): Can't create the cleaner.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ *  Stop the log cleaner. Must be called while the page tables still exist.
+ */
+void stopCleaner()
+{
+    if (CleanerPID == EMPTY)
+    {
+        return;
+    }
+    CleanQuit = TRUE;
+    semvReal(CleanSem);
+    sempReal(CleanDoneSem);
+    zap(CleanerPID);  // the caller may not quit before its child does
+    semfreeReal(CleanSem);
+    semfreeReal(CleanDoneSem);
+    CleanerPID = EMPTY;
+}
+
+/*
+ *  Returns TRUE if the given disk unit holds swap space
+ */
+int isSwapUnit(int unit)
+{
+    for (int i = 0; i < SwapDisks; i++)
+    {
+        if ((SWAPDISK + i) % USLOSS_DISK_UNITS == unit)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ *  Returns the number of swap blocks spread over the swap disks
+ */
+int swapBlocks()
+{
+    int blocks = EMPTY;
+    for (int i = 0; i < SwapDisks; i++)
+    {
+        int sector;
+        int track;
+        int disk;
+        diskSizeReal((SWAPDISK + i) % USLOSS_DISK_UNITS, &sector, &track, &disk);
+        int unitBlocks = disk * track * sector / USLOSS_MmuPageSize();
+        if (blocks == EMPTY || unitBlocks < blocks)
+        {
+            blocks = unitBlocks;
+        }
+    }
+    return blocks * SwapDisks;
+}
+
+/*
+ *  Free the swap disk layout
+ */
+void destroySwap()
+{
+    free(BlockMasks);
+    free(RunRefs);
+    free(ExtentOwners);
+    free(ExtentRegions);
+    free(AheadData);
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        if (Requests[i].sem != EMPTY)
+        {
+            semfreeReal(Requests[i].sem);
+            Requests[i].sem = EMPTY;
+        }
+    }
+}
+
+/*
+ *  Write the page in the buffer to the swap space of the given page table
+ *  entry, allocating space first if it has none. Under the compressed format
+ *  the page is compressed and moved to a run of sectors that fits it. A run
+ *  shared with other pages is left to them and the page gets its own. Under
+ *  the log-structured layout the page always moves to the log head. New
+ *  space is placed in the extent of the given page of the given owner, a
+ *  pid or MAXPROC + id for a segment, if there is room.
+ *  Returns FALSE if the swap disk is full.
+ */
+int swapWrite(char *buffer, PTE *pte, int owner, int page)
+{
+    char data[USLOSS_MmuPageSize()];
+    Placement place;
+    if (!placePage(buffer, data, pte, owner, page, &place))
+    {
+        return FALSE;
+    }
+    writeSectors(place.block, place.sector, place.sectors, place.source);
+    return TRUE;
+}
+
+/*
+ *  Write the given number of pages, which follow each other in the buffer,
+ *  to the swap space of the given page table entries of the given owner as
+ *  swapWrite does. The pages stored whole in blocks that follow each other
+ *  on one disk are written in one request. Returns the number of pages
+ *  written, from the first, which is less than count only if the swap disk
+ *  is full.
+ */
+int swapWriteRun(char *buffer, PTE *ptes[], int owner, int pages[], int count)
+{
+    int size = USLOSS_MmuPageSize();
+    char *data = malloc(count * size);
+    Placement *places = malloc(count * sizeof(Placement));
+    if (data == NULL || places == NULL)
+    {
+        USLOSS_Console("swapWriteRun(): Could not malloc the run.\n");
+        USLOSS_Halt(1);
+    }
+    int placed = 0;
+    while (placed < count && placePage(buffer + placed * size, data + placed * size,
+            ptes[placed], owner, pages[placed], &places[placed]))
+    {
+        placed++;
+    }
+
+    // Pages stored whole at the start of their blocks join the run before
+    for (int i = 0; i < placed; )
+    {
+        int run = 1;
+        while (i + run < placed && wholeBlock(&places[i]) && wholeBlock(&places[i + run]) &&
+                places[i + run].source == places[i].source + run * size &&
+                places[i + run].block == places[i].block + run * SwapDisks)
+        {
+            run++;
+        }
+        writeSectors(places[i].block, places[i].sector, places[i].sectors + (run - 1) * SectorsPerPage,
+                places[i].source);
+        i += run;
+    }
+    free(data);
+    free(places);
+    return placed;
+}
+
+/*
+ *  Compress the page in the buffer into data if that saves space, and
+ *  allocate swap space for it as swapWrite describes. Sets where the page
+ *  goes and the copy to write there. Returns FALSE if the swap disk is full.
+ */
+static int placePage(char *buffer, char *data, PTE *pte, int owner, int page, Placement *place)
+{
+    place->source = buffer;
+    int *sectors = &place->sectors;
+    *sectors = SectorsPerPage;
+    if (CompressedSwap)
+    {
+        // Two bytes of length, then the compressed page. Pages that would
+        // not save a sector are stored as is.
+        int max = (SectorsPerPage - 1) * USLOSS_DISK_SECTOR_SIZE - 2;
+        int length = compressPage(buffer, data + 2, max);
+        if (length >= 0)
+        {
+            data[0] = (char) (length >> 8);
+            data[1] = (char) length;
+            *sectors = (length + 2 + USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE;
+            place->source = data;
+        }
+    }
+
+    lockMutex(SwapMutex);
+    if (pte->diskBlock != EMPTY && (LogSwap || pte->diskSectors != *sectors ||
+            RunRefs[pte->diskBlock * SectorsPerPage + pte->diskSector] > 1))
+    {
+        // The page changed size or shares its run; move it
+        releaseRun(pte);
+    }
+    if (pte->diskBlock == EMPTY)
+    {
+        int block;
+        int sector;
+        if (!(LogSwap && logAlloc(*sectors, &block, &sector)) &&
+                !(!LogSwap && extentAlloc(*sectors, owner, page, &block, &sector)) &&
+                !allocRun(*sectors, &block, &sector))
+        {
+            unlockMutex(SwapMutex);
+            return FALSE;
+        }
+        pte->diskBlock = block;
+        pte->diskSector = sector;
+        pte->diskSectors = *sectors;
+        RunRefs[block * SectorsPerPage + sector] = 1;
+    }
+    place->block = pte->diskBlock;
+    place->sector = pte->diskSector;
+
+    // Wake the cleaner when free blocks run low
+    if (CleanerPID != EMPTY && !CleanPending &&
+            freeBlocks() * 100 < NumBlocks * LOG_CLEAN_FREE)
+    {
+        CleanPending = TRUE;
+        semvReal(CleanSem);
+    }
+    unlockMutex(SwapMutex);
+    return TRUE;
+}
+
+/*
+ *  Returns TRUE if the placed page fills its block
+ */
+static int wholeBlock(Placement *place)
+{
+    return place->sector == 0 && place->sectors == SectorsPerPage;
+}
+
+/*
+ *  Read the page stored in the swap space of the given page table entry
+ *  into the buffer
+ */
+void swapRead(char *buffer, PTE *pte)
+{
+    // Pages advised to be used at random gain nothing from reading ahead
+    int ahead = pte->advice != VM_ADV_RANDOM;
+    if (pte->diskSectors == SectorsPerPage)
+    {
+        readBlock(pte->diskBlock, pte->diskSector, pte->diskSectors, ahead, buffer);
+        return;
+    }
+
+    char data[USLOSS_MmuPageSize()];
+    readBlock(pte->diskBlock, pte->diskSector, pte->diskSectors, ahead, data);
+    int length = ((unsigned char) data[0] << 8) | (unsigned char) data[1];
+    decompressPage(data + 2, length, buffer);
+}
+
+/*
+ *  Returns how many of the given page table entries, from the first, hold
+ *  whole blocks that follow each other on one disk, at most READ_AHEAD,
+ *  and sets the first of those blocks
+ */
+int swapRun(PTE *ptes[], int count, int *block)
+{
+    lockMutex(SwapMutex);
+    *block = ptes[0]->diskBlock;
+    int run = 0;
+    while (run < count && run < READ_AHEAD && ptes[run]->diskBlock != EMPTY &&
+            ptes[run]->diskSector == 0 && ptes[run]->diskSectors == SectorsPerPage &&
+            ptes[run]->diskBlock == *block + run * SwapDisks)
+    {
+        run++;
+    }
+    unlockMutex(SwapMutex);
+    return run;
+}
+
+/*
+ *  Read the given number of blocks, at most READ_AHEAD, that follow the
+ *  given block on its disk into the read-ahead buffer in one request, so
+ *  that swap reads of them are served from memory
+ */
+void swapReadRun(int block, int count)
+{
+    char *data = malloc(count * USLOSS_MmuPageSize());
+    if (data == NULL)
+    {
+        USLOSS_Console("swapReadRun(): Could not malloc the run.\n");
+        USLOSS_Halt(1);
+    }
+    lockMutex(SwapMutex);
+    int writes = Writes;
+    unlockMutex(SwapMutex);
+
+    readSectors(block, 0, count * SectorsPerPage, data);
+
+    // Keep the run unless a write may have overtaken the read
+    lockMutex(SwapMutex);
+    if (Writes == writes)
+    {
+        memcpy(AheadData, data, count * USLOSS_MmuPageSize());
+        AheadBlock = block;
+        AheadCount = count;
+    }
+    unlockMutex(SwapMutex);
+    free(data);
+}
+
+/*
+ *  Release the swap space of the given page table entry, if any
+ */
+void swapFree(PTE *pte)
+{
+    lockMutex(SwapMutex);
+    releaseRun(pte);
+    unlockMutex(SwapMutex);
+}
+
+/*
+ *  Make the second page table entry share the swap space of the first,
+ *  releasing whatever space it had before
+ */
+void swapShare(PTE *from, PTE *to)
+{
+    lockMutex(SwapMutex);
+    releaseRun(to);
+    if (from->diskBlock != EMPTY)
+    {
+        to->diskBlock = from->diskBlock;
+        to->diskSector = from->diskSector;
+        to->diskSectors = from->diskSectors;
+        RunRefs[from->diskBlock * SectorsPerPage + from->diskSector]++;
+    }
+    unlockMutex(SwapMutex);
+}
+
+/*
+ *  Release the swap space of the given page table entry, if any. The space
+ *  is only freed once no other entry shares it.
+ *  Must be called with the swap mutex held.
+ */
+static void releaseRun(PTE *pte)
+{
+    if (pte->diskBlock == EMPTY)
+    {
+        return;
+    }
+    if (--RunRefs[pte->diskBlock * SectorsPerPage + pte->diskSector] == 0)
+    {
+        int run = ((1 << pte->diskSectors) - 1) << pte->diskSector;
+        BlockMasks[pte->diskBlock] &= ~run;
+
+        // An extent is given up once its last page leaves it
+        int extent = blockExtent(pte->diskBlock);
+        if (extent != EMPTY && ExtentOwners[extent] != EMPTY && extentFree(extent))
+        {
+            ExtentOwners[extent] = EMPTY;
+        }
+    }
+    pte->diskBlock = EMPTY;
+    pte->diskSector = 0;
+    pte->diskSectors = 0;
+}
+
+/*
+ *  Find the given number of free adjacent sectors in one block, preferring
+ *  blocks that are already partly used. A free block is taken from the disk
+ *  with the fewest requests outstanding. Blocks in extents that have an
+ *  owner are left to it while there is room elsewhere, and only used once
+ *  there is not. Returns FALSE if there are none.
+ *  Must be called with the swap mutex held.
+ */
+static int allocRun(int sectors, int *block, int *sector)
+{
+    return scanRun(sectors, FALSE, block, sector) ||
+        scanRun(sectors, TRUE, block, sector);
+}
+
+/*
+ *  Search for a run for allocRun, in owned extents too if the flag is set
+ */
+static int scanRun(int sectors, int owned, int *block, int *sector)
+{
+    int run = (1 << sectors) - 1;
+    int freeBlock = EMPTY;
+    for (int b = 0; b < NumBlocks; b++)
+    {
+        int extent = blockExtent(b);
+        if (b / LOG_SEGMENT == CleaningSegment ||
+                (!owned && extent != EMPTY && ExtentOwners[extent] != EMPTY))
+        {
+            continue;
+        }
+        if (BlockMasks[b] == 0)
+        {
+            if (freeBlock == EMPTY ||
+                    InFlight[blockUnit(b)] < InFlight[blockUnit(freeBlock)])
+            {
+                freeBlock = b;
+            }
+            continue;
+        }
+        for (int s = 0; s + sectors <= SectorsPerPage; s++)
+        {
+            if ((BlockMasks[b] & (run << s)) == 0)
+            {
+                BlockMasks[b] |= run << s;
+                *block = b;
+                *sector = s;
+                return TRUE;
+            }
+        }
+    }
+    if (freeBlock == EMPTY)
+    {
+        return FALSE;
+    }
+    BlockMasks[freeBlock] = run;
+    *block = freeBlock;
+    *sector = 0;
+    return TRUE;
+}
+
+/*
+ *  Allocate a whole block for the given page of the given owner in the
+ *  extent holding its region, claiming a free extent if it has none. The
+ *  page's own block of the extent is preferred. Returns FALSE if the
+ *  owner is EMPTY or there is no room.
+ *  Must be called with the swap mutex held.
+ */
+static int extentAlloc(int sectors, int owner, int page, int *block, int *sector)
+{
+    if (NumExtents == 0 || owner == EMPTY)
+    {
+        return FALSE;
+    }
+    int region = page / ExtentBlocks;
+    int extent = EMPTY;
+    for (int x = 0; x < NumExtents && extent == EMPTY; x++)
+    {
+        if (ExtentOwners[x] == owner && ExtentRegions[x] == region)
+        {
+            extent = x;
+        }
+    }
+    for (int x = 0; x < NumExtents && extent == EMPTY; x++)
+    {
+        if (ExtentOwners[x] == EMPTY && extentFree(x))
+        {
+            extent = x;
+            ExtentOwners[x] = owner;
+            ExtentRegions[x] = region;
+        }
+    }
+    if (extent == EMPTY)
+    {
+        return FALSE;
+    }
+
+    for (int i = 0; i < ExtentBlocks; i++)
+    {
+        int b = extentBlock(extent, (page + i) % ExtentBlocks);
+        if (BlockMasks[b] == 0)
+        {
+            BlockMasks[b] = (1 << sectors) - 1;
+            *block = b;
+            *sector = 0;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ *  Return block k of the given extent
+ */
+static int extentBlock(int extent, int k)
+{
+    int local = extent / SwapDisks * ExtentBlocks + k;
+    return local * SwapDisks + extent % SwapDisks;
+}
+
+/*
+ *  Return the extent holding the given block, or EMPTY if it is in none
+ */
+static int blockExtent(int block)
+{
+    int extent = block / SwapDisks / ExtentBlocks * SwapDisks + block % SwapDisks;
+    return extent < NumExtents ? extent : EMPTY;
+}
+
+/*
+ *  Returns TRUE if no sector of the given extent is in use.
+ *  Must be called with the swap mutex held.
+ */
+static int extentFree(int extent)
+{
+    for (int k = 0; k < ExtentBlocks; k++)
+    {
+        if (BlockMasks[extentBlock(extent, k)] != 0)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ *  Allocate the given number of sectors at the log head: in the head block
+ *  if it has room, otherwise at the start of the next free block after it.
+ *  Returns FALSE if no block is free.
+ *  Must be called with the swap mutex held.
+ */
+static int logAlloc(int sectors, int *block, int *sector)
+{
+    int run = (1 << sectors) - 1;
+    if (LogBlock != EMPTY && LogSector + sectors <= SectorsPerPage &&
+            (BlockMasks[LogBlock] & (run << LogSector)) == 0)
+    {
+        BlockMasks[LogBlock] |= run << LogSector;
+        *block = LogBlock;
+        *sector = LogSector;
+        LogSector += sectors;
+        return TRUE;
+    }
+
+    int start = LogBlock == EMPTY ? 0 : LogBlock + 1;
+    for (int i = 0; i < NumBlocks; i++)
+    {
+        int b = (start + i) % NumBlocks;
+        if (BlockMasks[b] == 0 && b / LOG_SEGMENT != CleaningSegment)
+        {
+            BlockMasks[b] = run;
+            LogBlock = b;
+            LogSector = sectors;
+            *block = b;
+            *sector = 0;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ *  Returns the number of swap blocks with no sectors in use.
+ *  Must be called with the swap mutex held.
+ */
+static int freeBlocks()
+{
+    int count = 0;
+    for (int b = 0; b < NumBlocks; b++)
+    {
+        count += BlockMasks[b] == 0;
+    }
+    return count;
+}
+
+/*
+ *  Kernel process that compacts the swap log when free blocks run low
+ */
+static int Cleaner(char *arg)
+{
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("Cleaner(): called.\n");
+    }
+    while (TRUE)
+    {
+        sempReal(CleanSem);
+        if (CleanQuit)
+        {
+            break;
+        }
+        cleanPass();
+        lockMutex(SwapMutex);
+        CleanPending = FALSE;
+        unlockMutex(SwapMutex);
+    }
+    semvReal(CleanDoneSem);
+    return 0;
+}
+
+/*
+ *  Clean the log segments with the least live data until enough blocks
+ *  are free or no segment is worth cleaning
+ */
+static void cleanPass()
+{
+    while (!CleanQuit)
+    {
+        lockMutex(SwapMutex);
+        int segment = freeBlocks() * 100 < NumBlocks * LOG_CLEAN_TARGET ? pickSegment() : EMPTY;
+        CleaningSegment = segment;
+        unlockMutex(SwapMutex);
+        if (segment == EMPTY)
+        {
+            break;
+        }
+
+        int moved = 0;
+        int end = (segment + 1) * LOG_SEGMENT < NumBlocks ? (segment + 1) * LOG_SEGMENT : NumBlocks;
+        for (int b = segment * LOG_SEGMENT; b < end; b++)
+        {
+            for (int s = 0; s < SectorsPerPage; s++)
+            {
+                moved += moveRun(b, s);
+            }
+        }
+
+        lockMutex(SwapMutex);
+        CleaningSegment = EMPTY;
+        unlockMutex(SwapMutex);
+
+        lockMutex(vmStatsMutex);
+        vmStats.segmentsCleaned++;
+        vmStats.runsMoved += moved;
+        unlockMutex(vmStatsMutex);
+
+        if (DEBUG5 && debugflag5)
+        {
+            USLOSS_Console("cleanPass(): Cleaned log segment %d, moving %d runs.\n", segment, moved);
+        }
+    }
+}
+
+/*
+ *  Choose the log segment with the least live data, if at most half of it
+ *  is live and the rest of the log has room for that data. The segment at
+ *  the log head is left alone. Returns EMPTY if none qualifies.
+ *  Must be called with the swap mutex held.
+ */
+static int pickSegment()
+{
+    int segments = (NumBlocks + LOG_SEGMENT - 1) / LOG_SEGMENT;
+    int best = EMPTY;
+    int bestLive = 0;
+    for (int g = 0; g < segments; g++)
+    {
+        int live = liveSectors(g);
+        int size = ((g + 1) * LOG_SEGMENT < NumBlocks ? LOG_SEGMENT : NumBlocks - g * LOG_SEGMENT) *
+                SectorsPerPage;
+        if (live == 0 || live * 2 > size || (LogBlock != EMPTY && g == LogBlock / LOG_SEGMENT))
+        {
+            continue;
+        }
+        if (best == EMPTY || live < bestLive)
+        {
+            best = g;
+            bestLive = live;
+        }
+    }
+    if (best != EMPTY && (freeBlocks() - LOG_SEGMENT) * SectorsPerPage < bestLive)
+    {
+        return EMPTY;
+    }
+    return best;
+}
+
+/*
+ *  Returns the number of sectors in use in the given log segment.
+ *  Must be called with the swap mutex held.
+ */
+static int liveSectors(int segment)
+{
+    int live = 0;
+    for (int b = segment * LOG_SEGMENT; b < (segment + 1) * LOG_SEGMENT && b < NumBlocks; b++)
+    {
+        for (int s = 0; s < SectorsPerPage; s++)
+        {
+            live += (BlockMasks[b] >> s) & 1;
+        }
+    }
+    return live;
+}
+
+/*
+ *  Copy the run starting at the given sector of the given block, if there
+ *  is one, to the log head and point its pages at the copy. The move is
+ *  abandoned if one of the pages is being loaded meanwhile; the pages
+ *  rewritten meanwhile have already left the run. Returns TRUE if the run
+ *  was moved.
+ */
+static int moveRun(int block, int sector)
+{
+    lockMutex(SwapMutex);
+    int sectors = 0;
+    if (RunRefs[block * SectorsPerPage + sector] == 0 ||
+            !forEachOwner(block, sector, EMPTY, 0, &sectors))
+    {
+        unlockMutex(SwapMutex);
+        return FALSE;
+    }
+    int newBlock;
+    int newSector;
+    if (!logAlloc(sectors, &newBlock, &newSector))
+    {
+        unlockMutex(SwapMutex);
+        return FALSE;
+    }
+    unlockMutex(SwapMutex);
+
+    char data[USLOSS_MmuPageSize()];
+    readSectors(block, sector, sectors, data);
+    writeSectors(newBlock, newSector, sectors, data);
+
+    lockMutex(FramesMutex);
+    lockMutex(SwapMutex);
+    int moved = RunRefs[block * SectorsPerPage + sector] > 0 &&
+            forEachOwner(block, sector, EMPTY, 0, &sectors);
+    int run = (1 << sectors) - 1;
+    if (moved)
+    {
+        forEachOwner(block, sector, newBlock, newSector, &sectors);
+        RunRefs[newBlock * SectorsPerPage + newSector] = RunRefs[block * SectorsPerPage + sector];
+        RunRefs[block * SectorsPerPage + sector] = 0;
+        BlockMasks[block] &= ~(run << sector);
+    }
+    else
+    {
+        BlockMasks[newBlock] &= ~(run << newSector);
+    }
+    unlockMutex(SwapMutex);
+    unlockMutex(FramesMutex);
+    return moved;
+}
+
+/*
+ *  Visit the page table entries of every process and segment that keep
+ *  the run starting at the given sector of the given block, setting the
+ *  length of the run. If a new block is given, the entries are pointed at
+ *  the new run. Returns FALSE if there are none, or if one of them is being
+ *  loaded into a frame or written out of one.
+ *  Must be called with the swap mutex held, and the frames mutex too when
+ *  moving the run.
+ */
+static int forEachOwner(int block, int sector, int newBlock, int newSector, int *sectors)
+{
+    int found = FALSE;
+    for (int t = 0; t < MAXPROC + MAXSEGMENTS; t++)
+    {
+        int pages = NumPages;
+        PTE *table = t < MAXPROC ? getProc(t)->pageTable : segmentPageTable(t - MAXPROC, &pages);
+        for (int i = 0; table != NULL && i < pages; i++)
+        {
+            PTE *pte = &table[i];
+            if (pte->diskBlock != block || pte->diskSector != sector)
+            {
+                continue;
+            }
+            if (pte->loading || (pte->state == INMEM && pte->frame != EMPTY && FrameTable[pte->frame].locked))
+            {
+                return FALSE;
+            }
+            found = TRUE;
+            *sectors = pte->diskSectors;
+            if (newBlock != EMPTY)
+            {
+                pte->diskBlock = newBlock;
+                pte->diskSector = newSector;
+            }
+        }
+    }
+    return found;
+}
+
+/*
+ *  Read sectors of the given block into the buffer through the read-ahead
+ *  buffer. On a miss in an extent, the blocks in use that follow the block
+ *  in its extent are read along with it in one request, if ahead is set.
+ */
+static void readBlock(int block, int first, int count, int ahead, char *buffer)
+{
+    lockMutex(SwapMutex);
+    int k = aheadIndex(block);
+    if (k != EMPTY)
+    {
+        memcpy(buffer, AheadData + k * USLOSS_MmuPageSize() + first * USLOSS_DISK_SECTOR_SIZE,
+                count * USLOSS_DISK_SECTOR_SIZE);
+        unlockMutex(SwapMutex);
+
+        lockMutex(vmStatsMutex);
+        vmStats.readAheadHits++;
+        unlockMutex(vmStatsMutex);
+        return;
+    }
+    int window = ahead ? aheadWindow(block) : 1;
+    int writes = Writes;
+    unlockMutex(SwapMutex);
+
+    if (window <= 1)
+    {
+        readSectors(block, first, count, buffer);
+        return;
+    }
+    char *data = malloc(window * USLOSS_MmuPageSize());
+    if (data == NULL)
+    {
+        USLOSS_Console("readBlock(): Could not malloc the read-ahead window.\n");
+        USLOSS_Halt(1);
+    }
+    readSectors(block, 0, window * SectorsPerPage, data);
+    memcpy(buffer, data + first * USLOSS_DISK_SECTOR_SIZE, count * USLOSS_DISK_SECTOR_SIZE);
+
+    // Keep the window unless a write may have overtaken the read
+    lockMutex(SwapMutex);
+    if (Writes == writes)
+    {
+        memcpy(AheadData, data, window * USLOSS_MmuPageSize());
+        AheadBlock = block;
+        AheadCount = window;
+    }
+    unlockMutex(SwapMutex);
+    free(data);
+}
+
+/*
+ *  Return the position of the given block in the read-ahead buffer, or
+ *  EMPTY if it is not there. Must be called with the swap mutex held.
+ */
+static int aheadIndex(int block)
+{
+    for (int k = 0; AheadBlock != EMPTY && k < AheadCount; k++)
+    {
+        if (AheadBlock + k * SwapDisks == block)
+        {
+            return k;
+        }
+    }
+    return EMPTY;
+}
+
+/*
+ *  Return the number of blocks to read starting at the given block: the
+ *  block and the blocks in use after it in its extent, up to READ_AHEAD.
+ *  Must be called with the swap mutex held.
+ */
+static int aheadWindow(int block)
+{
+    int extent = blockExtent(block);
+    if (extent == EMPTY || ExtentOwners[extent] == EMPTY)
+    {
+        return 1;
+    }
+    int k = block / SwapDisks % ExtentBlocks;
+    int window = 1;
+    while (window < READ_AHEAD && k + window < ExtentBlocks &&
+            BlockMasks[extentBlock(extent, k + window)] != 0)
+    {
+        window++;
+    }
+    return window;
+}
+
+/*
+ *  Read sectors of the given block of the swap disk into the buffer
+ */
+static void readSectors(int block, int first, int count, char *buffer)
+{
+    int unit = blockUnit(block);
+    int totalSectors = SectorsPerPage * (block / SwapDisks) + first;
+    int track = totalSectors / USLOSS_DISK_TRACK_SIZE;
+    int sector = totalSectors % USLOSS_DISK_TRACK_SIZE;
+    startIO(unit, track, TRUE);
+    diskReadReal(unit, track, sector, count, buffer);
+    finishIO(unit);
+
+    lockMutex(vmStatsMutex);
+    vmStats.sectorsRead += count;
+    vmStats.unitReads[unit]++;
+    unlockMutex(vmStatsMutex);
+}
+
+/*
+ *  Write the buffer to sectors of the given block of the swap disk
+ */
+static void writeSectors(int block, int first, int count, char *buffer)
+{
+    int unit = blockUnit(block);
+    int totalSectors = SectorsPerPage * (block / SwapDisks) + first;
+    int track = totalSectors / USLOSS_DISK_TRACK_SIZE;
+    int sector = totalSectors % USLOSS_DISK_TRACK_SIZE;
+
+    // A write drops the read-ahead buffer if it overlaps a block written
+    lockMutex(SwapMutex);
+    Writes++;
+    for (int b = 0; b * SectorsPerPage < first + count; b++)
+    {
+        if (aheadIndex(block + b * SwapDisks) != EMPTY)
+        {
+            AheadBlock = EMPTY;
+        }
+    }
+    unlockMutex(SwapMutex);
+
+    startIO(unit, track, FALSE);
+    diskWriteReal(unit, track, sector, count, buffer);
+    finishIO(unit);
+
+    lockMutex(vmStatsMutex);
+    vmStats.sectorsWritten += count;
+    vmStats.unitWrites[unit]++;
+    unlockMutex(vmStatsMutex);
+}
+
+/*
+ *  Return the disk unit holding the given block
+ */
+static int blockUnit(int block)
+{
+    return (SWAPDISK + block % SwapDisks) % USLOSS_DISK_UNITS;
+}
+
+/*
+ *  Count a request for the given track as outstanding on the given unit.
+ *  Under the scheduler, wait until the unit is ours.
+ */
+static void startIO(int unit, int track, int read)
+{
+    lockMutex(SwapMutex);
+    InFlight[unit]++;
+    if (!SwapScheduler || !Busy[unit])
+    {
+        Busy[unit] = SwapScheduler;
+        int distance = seek(unit, track);
+        unlockMutex(SwapMutex);
+        countSeek(distance);
+        return;
+    }
+
+    IORequest *request = &Requests[getpid() % MAXPROC];
+    request->waiting = TRUE;
+    request->unit = unit;
+    request->track = track;
+    request->read = read;
+    request->arrived = currentTime();
+    unlockMutex(SwapMutex);
+    sempReal(request->sem);
+}
+
+/*
+ *  Count a request on the given unit as finished. Under the scheduler,
+ *  hand the unit to the next queued request.
+ */
+static void finishIO(int unit)
+{
+    lockMutex(SwapMutex);
+    InFlight[unit]--;
+    int next = SwapScheduler ? nextRequest(unit) : EMPTY;
+    if (next == EMPTY)
+    {
+        Busy[unit] = FALSE;
+        unlockMutex(SwapMutex);
+        return;
+    }
+    Requests[next].waiting = FALSE;
+    int distance = seek(unit, Requests[next].track);
+    unlockMutex(SwapMutex);
+    countSeek(distance);
+    semvReal(Requests[next].sem);
+}
+
+/*
+ *  Choose the next queued request for the given unit: the oldest read past
+ *  its deadline, or else the nearest track at or beyond the head, wrapping
+ *  around to the lowest. Returns EMPTY if none is queued.
+ *  Must be called with the swap mutex held.
+ */
+static int nextRequest(int unit)
+{
+    int now = currentTime();
+    int next = EMPTY;
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        IORequest *request = &Requests[i];
+        if (request->waiting && request->unit == unit && request->read &&
+                now - request->arrived >= READ_DEADLINE &&
+                (next == EMPTY || request->arrived < Requests[next].arrived))
+        {
+            next = i;
+        }
+    }
+    if (next != EMPTY)
+    {
+        return next;
+    }
+
+    int wrap = EMPTY;
+    for (int i = 0; i < MAXPROC; i++)
+    {
+        IORequest *request = &Requests[i];
+        if (!request->waiting || request->unit != unit)
+        {
+            continue;
+        }
+        if (request->track >= HeadTrack[unit])
+        {
+            if (next == EMPTY || request->track < Requests[next].track)
+            {
+                next = i;
+            }
+        }
+        else if (wrap == EMPTY || request->track < Requests[wrap].track)
+        {
+            wrap = i;
+        }
+    }
+    return next != EMPTY ? next : wrap;
+}
+
+/*
+ *  Move the head of the given unit to the given track, returning the
+ *  number of tracks crossed. Must be called with the swap mutex held.
+ */
+static int seek(int unit, int track)
+{
+    int distance = abs(track - HeadTrack[unit]);
+    HeadTrack[unit] = track;
+    return distance;
+}
+
+/*
+ *  Add a seek of the given distance to the statistics
+ */
+static void countSeek(int distance)
+{
+    lockMutex(vmStatsMutex);
+    vmStats.seeks++;
+    vmStats.seekTracks += distance;
+    unlockMutex(vmStatsMutex);
+}
@@ -0,0 +1,22 @@
+/*
+ * swap.h
+ */
+
+#ifndef _SWAP_H
+#define _SWAP_H
+
+#include "vm.h"
+
+extern void initSwap();
+extern void destroySwap();
+extern void stopCleaner();
+extern int isSwapUnit(int);
+extern int swapBlocks();
+extern int swapWrite(char *, PTE *, int, int);
+extern int swapWriteRun(char *, PTE *[], int, int[], int);
+extern void swapRead(char *, PTE *);
+extern int swapRun(PTE *[], int, int *);
+extern void swapReadRun(int, int);
+extern void swapFree(PTE *);
+extern void swapShare(PTE *, PTE *);
+#endif
@@ -0,0 +1,340 @@
+/*
+ *  File:  swapCache.c
+ *
+ *  Description:  This file contains the compressed in-memory swap cache that
+ *                sits between the frame table and the swap disk
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "compression.h"
+#include "swapCache.h"
+#include "swap.h"
+#include "vm.h"
+
+extern int debugflag5;
+
+/*
+ * Smallest size of a compressed page. Used to bound the number of entries.
+ */
+#define MIN_ENTRY_SIZE 64
+
+/*
+ * A compressed page held in the cache. The owner's page table entry stays
+ * ONDISK while the page is here; its disk block, if any, may be stale.
+ */
+typedef struct CacheEntry
+{
+    int pid;        // The proc that owns the page, EMPTY if the entry is unused
+    int page;       // The page stored in this entry
+    int length;     // Length of the compressed data
+    int lastUse;    // When the page was stored; the smallest is the coldest
+    char *data;     // The compressed data
+} CacheEntry;
+
+static CacheEntry *Cache;
+static int NumEntries = 0;
+static int CacheUsed = 0;   // Bytes of compressed data in the cache
+static int CacheClock = 0;
+static int CacheMutex;
+
+static void removeEntry(int);
+static int writeBackColdest();
+static int writeBack(int);
+
+/*
+ *  Initialize the swap cache
+ */
+void initSwapCache()
+{
+    NumEntries = 0;
+    CacheUsed = 0;
+    CacheClock = 0;
+    if (SwapCacheSize <= 0)
+    {
+        return;
+    }
+
+    NumEntries = SwapCacheSize / MIN_ENTRY_SIZE + 1;
+    Cache = malloc(NumEntries * sizeof(CacheEntry));
+    if (Cache == NULL)
+    {
+        USLOSS_Console("initSwapCache(): Could not malloc the swap cache.\n");
+        USLOSS_Halt(1);
+    }
+    for (int i = 0; i < NumEntries; i++)
+    {
+        Cache[i].pid = EMPTY;
+    }
+    CacheMutex = createMutex();
+}
+
+/*
+ *  Free the swap cache
+ */
+void destroySwapCache()
+{
+    if (NumEntries == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < NumEntries; i++)
+    {
+        if (Cache[i].pid != EMPTY)
+        {
+            removeEntry(i);
+        }
+    }
+    free(Cache);
+    NumEntries = 0;
+}
+
+/*
+ *  Compress the given page of the proc with the given pid into the cache,
+ *  writing the coldest pages back to disk to make room.
+ *  Returns FALSE if the page was not stored and must go to disk instead.
+ */
+int cachePutPage(char *buffer, int pid, int page)
+{
+    if (NumEntries == 0)
+    {
+        return FALSE;
+    }
+
+    // Pages that don't shrink by at least a quarter aren't worth caching
+    char compressed[USLOSS_MmuPageSize()];
+    int length = compressPage(buffer, compressed, USLOSS_MmuPageSize() * 3 / 4);
+    if (length < 0 || length > SwapCacheSize)
+    {
+        return FALSE;
+    }
+
+    lockMutex(CacheMutex);
+    for (int i = 0; i < NumEntries; i++)
+    {
+        if (Cache[i].pid == pid && Cache[i].page == page)
+        {
+            removeEntry(i);
+        }
+    }
+
+    // Make room
+    int slot = EMPTY;
+    while (TRUE)
+    {
+        for (int i = 0; i < NumEntries && slot == EMPTY; i++)
+        {
+            if (Cache[i].pid == EMPTY)
+            {
+                slot = i;
+            }
+        }
+        if (slot != EMPTY && CacheUsed + length <= SwapCacheSize)
+        {
+            break;
+        }
+        if (!writeBackColdest())
+        {
+            unlockMutex(CacheMutex);
+            return FALSE;
+        }
+    }
+
+    Cache[slot].data = malloc(length);
+    if (Cache[slot].data == NULL)
+    {
+        USLOSS_Console("cachePutPage(): Could not malloc a cache entry.\n");
+        USLOSS_Halt(1);
+    }
+    memcpy(Cache[slot].data, compressed, length);
+    Cache[slot].pid = pid;
+    Cache[slot].page = page;
+    Cache[slot].length = length;
+    Cache[slot].lastUse = ++CacheClock;
+    CacheUsed += length;
+    unlockMutex(CacheMutex);
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("cachePutPage(): Cached page %d of pid %d in %d bytes.\n", page, pid, length);
+    }
+
+    lockMutex(vmStatsMutex);
+    vmStats.cacheStores++;
+    vmStats.cacheBytes += length;
+    unlockMutex(vmStatsMutex);
+    return TRUE;
+}
+
+/*
+ *  Look for the given page of the proc with the given pid in the cache.
+ *  If it is there, decompress it into the buffer and drop it from the cache.
+ *  Returns TRUE on a hit.
+ */
+int cacheGetPage(char *buffer, int pid, int page)
+{
+    if (NumEntries == 0)
+    {
+        return FALSE;
+    }
+
+    lockMutex(CacheMutex);
+    int slot = EMPTY;
+    for (int i = 0; i < NumEntries && slot == EMPTY; i++)
+    {
+        if (Cache[i].pid == pid && Cache[i].page == page)
+        {
+            slot = i;
+        }
+    }
+    if (slot == EMPTY)
+    {
+        unlockMutex(CacheMutex);
+        return FALSE;
+    }
+    decompressPage(Cache[slot].data, Cache[slot].length, buffer);
+    removeEntry(slot);
+    unlockMutex(CacheMutex);
+
+    lockMutex(vmStatsMutex);
+    vmStats.cacheHits++;
+    unlockMutex(vmStatsMutex);
+    return TRUE;
+}
+
+/*
+ *  Write the given page of the proc with the given pid back to its disk
+ *  block if it is in the cache, so that the disk copy is up to date.
+ *  Returns FALSE if the swap disk is full.
+ */
+int cacheWriteBack(int pid, int page)
+{
+    if (NumEntries == 0)
+    {
+        return TRUE;
+    }
+
+    lockMutex(CacheMutex);
+    int written = TRUE;
+    for (int i = 0; i < NumEntries; i++)
+    {
+        if (Cache[i].pid == pid && Cache[i].page == page)
+        {
+            written = writeBack(i);
+        }
+    }
+    unlockMutex(CacheMutex);
+    return written;
+}
+
+/*
+ *  Drop the given page of the proc with the given pid from the cache
+ */
+void cacheDrop(int pid, int page)
+{
+    if (NumEntries == 0)
+    {
+        return;
+    }
+
+    lockMutex(CacheMutex);
+    for (int i = 0; i < NumEntries; i++)
+    {
+        if (Cache[i].pid == pid && Cache[i].page == page)
+        {
+            removeEntry(i);
+        }
+    }
+    unlockMutex(CacheMutex);
+}
+
+/*
+ *  Drop every page of the proc with the given pid from the cache
+ */
+void cacheForget(int pid)
+{
+    if (NumEntries == 0)
+    {
+        return;
+    }
+
+    lockMutex(CacheMutex);
+    for (int i = 0; i < NumEntries; i++)
+    {
+        if (Cache[i].pid == pid)
+        {
+            removeEntry(i);
+        }
+    }
+    unlockMutex(CacheMutex);
+}
+
+/*
+ *  Free the given entry. Must be called with the cache mutex held.
+ */
+static void removeEntry(int slot)
+{
+    CacheUsed -= Cache[slot].length;
+    free(Cache[slot].data);
+    Cache[slot].pid = EMPTY;
+}
+
+/*
+ *  Write the coldest page in the cache to its disk block and drop it.
+ *  Returns FALSE if the cache is empty or the swap disk is full.
+ *  Must be called with the cache mutex held.
+ */
+static int writeBackColdest()
+{
+    int coldest = EMPTY;
+    for (int i = 0; i < NumEntries; i++)
+    {
+        if (Cache[i].pid != EMPTY &&
+                (coldest == EMPTY || Cache[i].lastUse < Cache[coldest].lastUse))
+        {
+            coldest = i;
+        }
+    }
+    if (coldest == EMPTY)
+    {
+        return FALSE;
+    }
+    return writeBack(coldest);
+}
+
+/*
+ *  Write the page in the given entry to its disk block and drop it.
+ *  Returns FALSE if the swap disk is full.
+ *  Must be called with the cache mutex held.
+ */
+static int writeBack(int slot)
+{
+    PTE *pte = &getProc(Cache[slot].pid)->pageTable[Cache[slot].page];
+    char buffer[USLOSS_MmuPageSize()];
+    decompressPage(Cache[slot].data, Cache[slot].length, buffer);
+    if (!swapWrite(buffer, pte, Cache[slot].pid, Cache[slot].page))
+    {
+        return FALSE;
+    }
+
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("writeBack(): Wrote page %d of pid %d to block %d.\n",
+                Cache[slot].page, Cache[slot].pid, pte->diskBlock);
+    }
+    removeEntry(slot);
+
+    lockMutex(vmStatsMutex);
+    vmStats.pageOuts++;
+    vmStats.cacheWritebacks++;
+    unlockMutex(vmStatsMutex);
+    return TRUE;
+}
@@ -0,0 +1,15 @@
+/*
+ * swapCache.h
+ */
+
+#ifndef _SWAPCACHE_H
+#define _SWAPCACHE_H
+
+extern void initSwapCache();
+extern void destroySwapCache();
+extern int cachePutPage(char *, int, int);
+extern int cacheGetPage(char *, int, int);
+extern int cacheWriteBack(int, int);
+extern void cacheDrop(int, int);
+extern void cacheForget(int);
+#endif
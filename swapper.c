@@ -0,0 +1,143 @@
+/*
+ *  File:  swapper.c
+ *
+ *  Description:  This file contains the swapper, which swaps out the
+ *                resident pages of processes that have been idle for a
+ *                while
+ *
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "phase1.h"
+#include "phase2.h"
+#include "phase5.h"
+#include "phase5utility.h"
+#include "providedPrototypes.h"
+#include "swapper.h"
+#include "vm.h"
+
+extern int debugflag5;
+extern int NumPages;
+extern int FramesMutex;
+extern int swapOutProcess(int);
+
+/*
+ * Phase 1 does not say whether a process is blocked, but every process
+ * that is not running must be blocked when the sentinel runs, so
+ * p1_switch notes the time then. A process that has stayed blocked for
+ * IdleSwapTime microseconds since is taken to be waiting in Sleep or on a
+ * mailbox, and a process that is only waiting for the CPU is left alone.
+ * The swapper swaps such a process out once; it faults its pages back in
+ * when it runs again.
+ */
+static int SwapperPID = EMPTY;
+static int SwapperDoneSem;  // V'd by the swapper when it quits
+static int SwapperQuit;
+
+static int Swapper(char *);
+static int isIdle(Process *, int);
+
+/*
+ *  Start the swapper, if enabled
+ */
+void initSwapper()
+{
+    SwapperPID = EMPTY;
+    if (IdleSwapTime <= 0)
+    {
+        return;
+    }
+    SwapperDoneSem = semcreateReal(0);
+    SwapperQuit = FALSE;
+    SwapperPID = fork1("Swapper", Swapper, NULL, USLOSS_MIN_STACK, SWAPPER_PRIORITY);
+    if (SwapperPID < 0)
+    {
+        USLOSS_Console("initSwapper(): Can't create the swapper.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ *  Stop the swapper. Must be called before the MMU is turned off.
+ */
+void stopSwapper()
+{
+    if (SwapperPID == EMPTY)
+    {
+        return;
+    }
+    SwapperQuit = TRUE;
+    sempReal(SwapperDoneSem);
+    zap(SwapperPID);  // the caller may not quit before its child does
+    semfreeReal(SwapperDoneSem);
+    SwapperPID = EMPTY;
+}
+
+/*
+ *  Kernel process that swaps out idle processes
+ */
+static int Swapper(char *arg)
+{
+    if (DEBUG5 && debugflag5)
+    {
+        USLOSS_Console("Swapper(): called.\n");
+    }
+    while (!SwapperQuit)
+    {
+        for (int tick = 0; tick < SWAPPER_TICKS && !SwapperQuit; tick++)
+        {
+            int status;
+            waitDevice(USLOSS_CLOCK_DEV, 0, &status);
+        }
+        int now = currentTime();
+        for (int i = 0; i < MAXPROC && !SwapperQuit; i++)
+        {
+            Process *proc = getProc(i);
+            if (!isIdle(proc, now))
+            {
+                continue;
+            }
+            proc->idleSwapped = TRUE;
+            int freed = swapOutProcess(proc->pid);
+
+            if (DEBUG5 && debugflag5)
+            {
+                USLOSS_Console("Swapper(): Swapped out pid %d after %d blocked microseconds.\n", proc->pid, now - proc->blockedSince);
+            }
+            lockMutex(vmStatsMutex);
+            vmStats.idleSwapOuts++;
+            vmStats.idleFrames += freed;
+            unlockMutex(vmStatsMutex);
+        }
+    }
+    semvReal(SwapperDoneSem);
+    return 0;
+}
+
+/*
+ *  Returns whether the given process has been blocked for IdleSwapTime
+ *  microseconds and has pages of its own in memory. Processes with
+ *  reserved frames are never swapped out.
+ */
+static int isIdle(Process *proc, int now)
+{
+    if (proc->pid == EMPTY || proc->pid == getpid() || proc->idleSwapped ||
+            proc->quitting || proc->minFrames > 0 || proc->blockedSince == EMPTY ||
+            now - proc->blockedSince < IdleSwapTime)
+    {
+        return FALSE;
+    }
+    lockMutex(FramesMutex);
+    int resident = FALSE;
+    for (int i = 0; i < NumPages && !resident; i++)
+    {
+        PTE *pte = &proc->pageTable[i];
+        resident = pte->frame != EMPTY && !pte->cow && pte->segment == EMPTY;
+    }
+    unlockMutex(FramesMutex);
+    return resident;
+}
@@ -0,0 +1,10 @@
+/*
+ * swapper.h
+ */
+
+#ifndef _SWAPPER_H
+#define _SWAPPER_H
+
+extern void initSwapper();
+extern void stopSwapper();
+#endif
@@ -18,8 +18,40 @@
 #include "vm.h"
 #include "providedPrototypes.h"
 
+extern int VMInitialized;
+
 extern void *vmInitReal(int, int, int, int);
 extern void vmDestroyReal();
+extern int vmLimitReal(int, int, int);
+extern int vmShmCreateReal(char *, int);
+extern int vmShmAttachReal(int, void *);
+extern int vmShmDetachReal(int);
+extern int vmSpawnReal(char *, int (*)(char *), char *, int, int);
+extern int vmMapReal(int, int, int, int, void *);
+extern int vmSyncReal(void *, int);
+extern int vmUnmapReal(void *, int);
+extern int vmAdviseReal(void *, int, int);
+extern int vmLockReal(void *, int);
+extern int vmUnlockReal(void *, int);
+extern int vmPopulateReal(void *, int, int);
+extern int vmResidentReal(void *, int, char *);
+
+// The phase 3 handler for Terminate, which vmTerminate passes the call to
+void (*terminateHandler)(USLOSS_Sysargs *);
+
+/*
+ *  Syscall handler for Terminate. The process gives back its memory while
+ *  it may still block, then terminates as usual.
+ */
+void vmTerminate(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (VMInitialized)
+    {
+        releaseProcess(getpid());
+    }
+    terminateHandler(args);
+}
 
 /*
  *  Syscall handler for VmInit
@@ -65,3 +97,237 @@ void vmDestroy(USLOSS_Sysargs *args)
     vmDestroyReal();
     setToUserMode();
 }
+
+/*
+ *  Syscall handler for VmLimit
+ */
+void vmLimit(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMLIMIT)
+    {
+        USLOSS_Console("vmLimit(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    int pid = (int) ((long) args->arg1);
+    int minFrames = (int) ((long) args->arg2);
+    int maxFrames = (int) ((long) args->arg3);
+    args->arg4 = (void *) (long) vmLimitReal(pid, minFrames, maxFrames);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmShmCreate
+ */
+void vmShmCreate(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMSHMCREATE)
+    {
+        USLOSS_Console("vmShmCreate(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    char *name = (char *) args->arg1;
+    int pages = (int) ((long) args->arg2);
+    int segment = vmShmCreateReal(name, pages);
+    args->arg1 = (void *) (long) segment;
+    args->arg4 = (void *) (long) (segment < 0 ? -1 : 0);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmShmAttach
+ */
+void vmShmAttach(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMSHMATTACH)
+    {
+        USLOSS_Console("vmShmAttach(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    int segment = (int) ((long) args->arg1);
+    void *addr = args->arg2;
+    args->arg4 = (void *) (long) vmShmAttachReal(segment, addr);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmShmDetach
+ */
+void vmShmDetach(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMSHMDETACH)
+    {
+        USLOSS_Console("vmShmDetach(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    int segment = (int) ((long) args->arg1);
+    args->arg4 = (void *) (long) vmShmDetachReal(segment);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmSpawn
+ */
+void vmSpawn(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMSPAWN)
+    {
+        USLOSS_Console("vmSpawn(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    int (*func)(char *) = args->arg1;
+    char *arg = (char *) args->arg2;
+    int stackSize = (int) ((long) args->arg3);
+    int priority = (int) ((long) args->arg4);
+    char *name = (char *) args->arg5;
+    int pid = vmSpawnReal(name, func, arg, stackSize, priority);
+    args->arg1 = (void *) (long) pid;
+    args->arg4 = (void *) (long) (pid < 0 ? -1 : 0);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmMap
+ */
+void vmMap(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMMAP)
+    {
+        USLOSS_Console("vmMap(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int unit = (int) ((long) args->arg2);
+    int track = (int) ((long) args->arg3);
+    int first = (int) ((long) args->arg4);
+    int pages = (int) ((long) args->arg5);
+    args->arg4 = (void *) (long) vmMapReal(unit, track, first, pages, addr);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmSync
+ */
+void vmSync(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMSYNC)
+    {
+        USLOSS_Console("vmSync(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int pages = (int) ((long) args->arg2);
+    args->arg4 = (void *) (long) vmSyncReal(addr, pages);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmUnmap
+ */
+void vmUnmap(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMUNMAP)
+    {
+        USLOSS_Console("vmUnmap(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int pages = (int) ((long) args->arg2);
+    args->arg4 = (void *) (long) vmUnmapReal(addr, pages);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmAdvise
+ */
+void vmAdvise(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMADVISE)
+    {
+        USLOSS_Console("vmAdvise(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int pages = (int) ((long) args->arg2);
+    int hint = (int) ((long) args->arg3);
+    args->arg4 = (void *) (long) vmAdviseReal(addr, pages, hint);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmLock
+ */
+void vmLock(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMLOCK)
+    {
+        USLOSS_Console("vmLock(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int pages = (int) ((long) args->arg2);
+    args->arg4 = (void *) (long) vmLockReal(addr, pages);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmUnlock
+ */
+void vmUnlock(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMUNLOCK)
+    {
+        USLOSS_Console("vmUnlock(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int pages = (int) ((long) args->arg2);
+    args->arg4 = (void *) (long) vmUnlockReal(addr, pages);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmPopulate
+ */
+void vmPopulate(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMPOPULATE)
+    {
+        USLOSS_Console("vmPopulate(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int pages = (int) ((long) args->arg2);
+    int write = (int) ((long) args->arg3);
+    args->arg4 = (void *) (long) vmPopulateReal(addr, pages, write);
+    setToUserMode();
+}
+
+/*
+ *  Syscall handler for VmResident
+ */
+void vmResident(USLOSS_Sysargs *args)
+{
+    CheckMode();
+    if (args->number != SYS_VMRESIDENT)
+    {
+        USLOSS_Console("vmResident(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+    void *addr = args->arg1;
+    int pages = (int) ((long) args->arg2);
+    char *vec = (char *) args->arg3;
+    args->arg4 = (void *) (long) vmResidentReal(addr, pages, vec);
+    setToUserMode();
+}
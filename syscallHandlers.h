@@ -5,8 +5,23 @@
 #ifndef _SYSCALLHANDLERS_H
 #define _SYSCALLHANDLERS_H
 
+extern void (*terminateHandler)(USLOSS_Sysargs *);
+extern void vmTerminate(USLOSS_Sysargs *);
 extern void vmInit(USLOSS_Sysargs *);
 extern void vmDestroy(USLOSS_Sysargs *);
+extern void vmLimit(USLOSS_Sysargs *);
+extern void vmShmCreate(USLOSS_Sysargs *);
+extern void vmShmAttach(USLOSS_Sysargs *);
+extern void vmShmDetach(USLOSS_Sysargs *);
+extern void vmSpawn(USLOSS_Sysargs *);
+extern void vmMap(USLOSS_Sysargs *);
+extern void vmSync(USLOSS_Sysargs *);
+extern void vmUnmap(USLOSS_Sysargs *);
+extern void vmAdvise(USLOSS_Sysargs *);
+extern void vmLock(USLOSS_Sysargs *);
+extern void vmUnlock(USLOSS_Sysargs *);
+extern void vmPopulate(USLOSS_Sysargs *);
+extern void vmResident(USLOSS_Sysargs *);
 
 extern void mbox_create(USLOSS_Sysargs *args_ptr);
 extern void mbox_release(USLOSS_Sysargs *args_ptr);
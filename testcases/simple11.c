@@ -0,0 +1,130 @@
+/*
+ * simple11.c
+ *
+ * Load control with the active processes going quiet.
+ * Three processes each write every page of a region twice the size of
+ * memory, so load control may deactivate one of them. The others then
+ * block until all three are done writing, and stop faulting. A process
+ * that was deactivated must still be let back in to finish, so every
+ * deactivation is matched by a reactivation.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple11"
+#define PAGES       8
+#define CHILDREN    3
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  4
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+int doneSem;
+int goSem;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        for (int page = 0; page < PAGES; page++) {
+            sprintf(toPrint, "%c: page %d, iteration %d", *arg, page, i);
+            memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+                   strlen(toPrint)+1);  // +1 to copy nul character
+        }
+    }
+
+    // Stop faulting until every child is done writing
+    SemV(doneSem);
+    SemP(goSem);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "%c: page %d, iteration %d", *arg, page,
+                ITERATIONS - 1);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+
+    Terminate(137);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid[CHILDREN];
+    int  status;
+    char toPass;
+    char buffer[20];
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    LoadControl = 1;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    SemCreate(0, &doneSem);
+    SemCreate(0, &goSem);
+
+    toPass = 'A';
+    for (int i = 0; i < CHILDREN; i++) {
+        sprintf(buffer, "Child%c", toPass);
+        Spawn(buffer, Child, &toPass, USLOSS_MIN_STACK * 7, PRIORITY, &pid[i]);
+        toPass = toPass + 1;
+    }
+
+    for (int i = 0; i < CHILDREN; i++)
+        SemP(doneSem);
+    Tconsole("\nstart5(): all children are done writing\n");
+
+    for (int i = 0; i < CHILDREN; i++)
+        SemV(goSem);
+
+    for (int i = 0; i < CHILDREN; i++) {
+        Wait(&pid[i], &status);
+        assert(status == 137);
+    }
+    assert(vmStats.reactivations == vmStats.deactivations);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
@@ -0,0 +1,128 @@
+/*
+ * simple12.c
+ *
+ * One process limits itself to half of the frames with VmLimit and
+ * writes every page. The last two pages must replace its own first two
+ * pages even though there are free frames. Once the limit is lifted, the
+ * first two pages are read back into the free frames without replacing
+ * anything. Also checks that bad limits are refused.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple12"
+#define PAGES       4
+#define CHILDREN    1
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+#define LIMIT       2
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    assert(VmLimit(-1, 0, LIMIT) == -1);
+    assert(VmLimit(pid, 0, FRAMES + 1) == -1);
+    assert(VmLimit(pid, LIMIT + 1, LIMIT) == -1);
+    assert(VmLimit(pid, FRAMES, FRAMES) == -1);
+    assert(VmLimit(pid, 1, LIMIT) == 0);
+    Tconsole("Child(%d): limited to %d frames\n", pid, LIMIT);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    Tconsole("Child(%d): after writing every page\n", pid);
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageOuts == PAGES - LIMIT);
+    assert(vmStats.pageIns == 0);
+
+    // The last pages written are still resident
+    for (int page = LIMIT; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        assert(strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) == 0);
+    }
+    assert(vmStats.faults == PAGES);
+
+    assert(VmLimit(pid, 0, -1) == 0);
+    Tconsole("Child(%d): limit lifted\n", pid);
+
+    for (int page = 0; page < LIMIT; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            USLOSS_Halt(1);
+        }
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + LIMIT);
+    assert(vmStats.pageIns == LIMIT);
+    assert(vmStats.pageOuts == PAGES - LIMIT);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(121);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 121);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
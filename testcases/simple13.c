@@ -0,0 +1,171 @@
+/*
+ * simple13.c
+ *
+ * Two processes share a segment of two pages, attached at different
+ * addresses. ChildA attaches it and writes both pages. ChildB then
+ * attaches it and reads them without a page fault, since the pages are
+ * already in memory. Once both detach the segment is destroyed, and its
+ * name can be used again. No disk I/O should occur.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple13"
+#define PAGES       4
+#define CHILDREN    2
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+#define SEGMENT     2
+
+extern void *vmRegion;
+
+int segment;
+int writtenSem;
+int readSem;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Writer(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nWriter(%d): starting\n", pid);
+
+    assert(VmShmAttach(segment, vmRegion + USLOSS_MmuPageSize()) == 0);
+    Tconsole("Writer(%d): attached segment %d at page 1\n", pid, segment);
+
+    for (int page = 0; page < SEGMENT; page++) {
+        sprintf(toPrint, "segment page %d", page);
+        memcpy(vmRegion + (page + 1)*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == SEGMENT);
+    assert(vmStats.new == SEGMENT);
+    Tconsole("Writer(%d): wrote the segment\n", pid);
+
+    SemV(writtenSem);
+    SemP(readSem);
+
+    assert(VmShmDetach(segment) == 0);
+    assert(VmShmDetach(segment) == -1);
+    Tconsole("Writer(%d): detached segment %d\n", pid, segment);
+
+    Tconsole("Writer(%d): terminating\n\n", pid);
+
+    Terminate(131);
+    return 0;
+} /* Writer */
+
+
+int
+Reader(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nReader(%d): starting\n", pid);
+
+    assert(VmShmAttach(segment, vmRegion + (PAGES - 1)*USLOSS_MmuPageSize()) == -1);
+    assert(VmShmAttach(segment, vmRegion) == 0);
+    assert(VmShmAttach(segment, vmRegion + SEGMENT*USLOSS_MmuPageSize()) == -1);
+    Tconsole("Reader(%d): attached segment %d at page 0\n", pid, segment);
+
+    for (int page = 0; page < SEGMENT; page++) {
+        sprintf(toPrint, "segment page %d", page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Reader(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+    Tconsole("Reader(%d): read the segment\n", pid);
+
+    Tconsole("Reader(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == SEGMENT);
+    assert(vmStats.new == SEGMENT);
+    assert(vmStats.pageIns == 0);
+    assert(vmStats.pageOuts == 0);
+
+    assert(VmShmDetach(segment) == 0);
+    assert(VmShmDetach(segment) == -1);
+    Tconsole("Reader(%d): detached segment %d\n", pid, segment);
+
+    SemV(readSem);
+    Tconsole("Reader(%d): terminating\n\n", pid);
+
+    Terminate(132);
+    return 0;
+} /* Reader */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+    int  other;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    assert(VmShmCreate("", SEGMENT, &other) == -1);
+    assert(VmShmCreate("shared", PAGES + 1, &other) == -1);
+    assert(VmShmCreate("shared", SEGMENT, &segment) == 0);
+    assert(VmShmCreate("shared", SEGMENT, &other) == 0);
+    assert(other == segment);
+    assert(VmShmCreate("shared", SEGMENT + 1, &other) == -1);
+    Tconsole("start5(): created segment %d\n", segment);
+
+    SemCreate(0, &writtenSem);
+    SemCreate(0, &readSem);
+
+    Spawn("Writer", Writer, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+    SemP(writtenSem);
+    Spawn("Reader", Reader, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    for (int i = 0; i < CHILDREN; i++) {
+        Wait(&pid, &status);
+        assert(status == 131 || status == 132);
+    }
+
+    // The segment is gone, so its name may be used at another size
+    assert(VmShmCreate("shared", SEGMENT + 1, &other) == 0);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
@@ -0,0 +1,158 @@
+/*
+ * simple14.c
+ *
+ * One process writes both of its pages and spawns a clone of itself with
+ * VmSpawn. The clone reads the parent's pages without a page fault, then
+ * writes page 0, which copies it into a frame of its own. The parent's
+ * pages are unchanged. A VmSpawn that fails must leave the parent's pages
+ * writable. No disk I/O should occur.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple14"
+#define PAGES       2
+#define CHILDREN    1
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Clone(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nClone(%d): starting\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "parent page %d", page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Clone(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+    assert(vmStats.faults == PAGES);
+    Tconsole("Clone(%d): read the parent's pages\n", pid);
+
+    strcpy(vmRegion, "clone page 0");
+    assert(strcmp(vmRegion, "clone page 0") == 0);
+    assert(vmStats.faults == PAGES + 1);
+    assert(vmStats.cowFaults == 1);
+    Tconsole("Clone(%d): wrote page 0\n", pid);
+
+    Tconsole("Clone(%d): terminating\n\n", pid);
+
+    Terminate(142);
+    return 0;
+} /* Clone */
+
+
+int
+Parent(char *arg)
+{
+    int    pid;
+    int    clonePid;
+    int    status;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nParent(%d): starting\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "parent page %d", page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.new == PAGES);
+    Tconsole("Parent(%d): wrote both pages\n", pid);
+
+    // A clone that cannot be spawned leaves our pages as they were
+    assert(VmSpawn("Clone", Clone, NULL, USLOSS_MIN_STACK * 7, 0, &clonePid) == -1);
+    strcpy(vmRegion, "parent page 0");
+    assert(vmStats.faults == PAGES);
+    Tconsole("Parent(%d): VmSpawn refused a bad priority\n", pid);
+
+    assert(VmSpawn("Clone", Clone, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &clonePid) == 0);
+    Tconsole("Parent(%d): spawned Clone(%d)\n", pid, clonePid);
+
+    Wait(&clonePid, &status);
+    assert(status == 142);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "parent page %d", page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Parent(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+    Tconsole("Parent(%d): pages unchanged\n", pid);
+
+    Tconsole("Parent(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + 1);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 0);
+    assert(vmStats.pageOuts == 0);
+
+    Tconsole("Parent(%d): terminating\n\n", pid);
+
+    Terminate(141);
+    return 0;
+} /* Parent */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Parent", Parent, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 141);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
@@ -0,0 +1,135 @@
+/*
+ * simple15.c
+ *
+ * One process maps two pages of disk 0 into its VM region with VmMap,
+ * writes them and writes them back with VmSync. It unmaps them and maps
+ * the same sectors again, and must read back what it wrote. Touching a
+ * mapped page reads it from the disk; no swap I/O should occur.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple15"
+#define PAGES       4
+#define CHILDREN    1
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+#define MAPPED      2
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    int    sectorSize;
+    int    trackSize;
+    int    tracks;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    DiskSize(0, &sectorSize, &trackSize, &tracks);
+    assert(VmMap(1, 0, 0, MAPPED, vmRegion) == -1);
+    assert(VmMap(0, tracks - 1, 1, MAPPED, vmRegion) == -1);
+    assert(VmMap(0, 0, 0, MAPPED, vmRegion + 1) == -1);
+    assert(VmMap(0, 0, 0, MAPPED, vmRegion) == 0);
+    assert(VmMap(0, 0, 0, MAPPED, vmRegion) == -1);
+    Tconsole("Child(%d): mapped %d pages of disk 0\n", pid, MAPPED);
+
+    for (int page = 0; page < MAPPED; page++) {
+        sprintf(toPrint, "mapped page %d", page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == MAPPED);
+    assert(vmStats.new == 0);
+    assert(vmStats.mappedReads == MAPPED);
+
+    assert(VmSync(vmRegion, PAGES + 1) == -1);
+    assert(VmSync(vmRegion, MAPPED) == 0);
+    assert(vmStats.mappedWrites == MAPPED);
+    Tconsole("Child(%d): wrote the pages back\n", pid);
+
+    // The pages are clean, so unmapping writes nothing
+    assert(VmUnmap(vmRegion, MAPPED) == 0);
+    assert(vmStats.mappedWrites == MAPPED);
+    Tconsole("Child(%d): unmapped the pages\n", pid);
+
+    assert(VmMap(0, 0, 0, MAPPED, vmRegion) == 0);
+    for (int page = 0; page < MAPPED; page++) {
+        sprintf(toPrint, "mapped page %d", page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+    assert(VmUnmap(vmRegion, MAPPED) == 0);
+    Tconsole("Child(%d): read the pages back from the disk\n", pid);
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == 2 * MAPPED);
+    assert(vmStats.pageIns == 2 * MAPPED);
+    assert(vmStats.pageOuts == 0);
+    assert(vmStats.mappedReads == 2 * MAPPED);
+    assert(vmStats.mappedWrites == MAPPED);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(151);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 151);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
@@ -0,0 +1,132 @@
+/*
+ * simple16.c
+ *
+ * One process writes four pages with two frames, so pages 0 and 1 go to
+ * disk. VM_ADV_DONTNEED on page 2 frees its frame, and page 2 then reads
+ * as zeros without a disk read. Once the frame is free again,
+ * VM_ADV_WILLNEED brings page 0 back in, so reading it does not fault.
+ * There is no free frame left for page 1, which stays on disk.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple16"
+#define PAGES       4
+#define CHILDREN    1
+#define FRAMES      2
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+    char   *page2 = vmRegion + 2*USLOSS_MmuPageSize();
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    assert(VmAdvise(vmRegion, 1, -1) == -1);
+    assert(VmAdvise(vmRegion, 1, VM_ADV_FREE + 1) == -1);
+    assert(VmAdvise(vmRegion, PAGES + 1, VM_ADV_NORMAL) == -1);
+    assert(VmAdvise(vmRegion + 1, 1, VM_ADV_NORMAL) == -1);
+    assert(VmAdvise(vmRegion, PAGES, VM_ADV_SEQUENTIAL) == 0);
+    assert(VmAdvise(vmRegion, PAGES, VM_ADV_NORMAL) == 0);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+    Tconsole("Child(%d): wrote every page\n", pid);
+
+    assert(VmAdvise(page2, 1, VM_ADV_DONTNEED) == 0);
+    assert(vmStats.advisedDrops == 1);
+    for (int i = 0; i < USLOSS_MmuPageSize(); i++) {
+        assert(page2[i] == 0);
+    }
+    assert(vmStats.faults == PAGES + 1);
+    assert(vmStats.pageIns == 0);
+    Tconsole("Child(%d): page 2 was discarded\n", pid);
+
+    assert(VmAdvise(page2, 1, VM_ADV_DONTNEED) == 0);
+    assert(vmStats.advisedDrops == 2);
+    assert(VmAdvise(vmRegion, 2, VM_ADV_WILLNEED) == 0);
+    assert(vmStats.advisedFetches == 1);
+    assert(vmStats.pageIns == 1);
+
+    sprintf(toPrint, "Child(%d): page %d", pid, 0);
+    if (strcmp(vmRegion, toPrint) != 0) {
+        Tconsole("Child(%d): Wrong string read from page 0\n", pid);
+        Tconsole("  read: '%s'\n", vmRegion);
+        USLOSS_Halt(1);
+    }
+    Tconsole("Child(%d): page 0 was fetched\n", pid);
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + 1);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 1);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(161);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 161);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
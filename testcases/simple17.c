@@ -0,0 +1,134 @@
+/*
+ * simple17.c
+ *
+ * One process pins pages 0 and 1 with VmLock, which faults them in, and
+ * then writes the rest of a region twice the size of memory. The other
+ * pages have to take turns in the two frames that are left, and the
+ * pinned pages are read back without a fault. Pinning more than half of
+ * the frames is refused. The pins left when the process quits are given
+ * back.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple17"
+#define PAGES       8
+#define CHILDREN    1
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+#define PINNED      2
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    assert(VmLock(vmRegion, PINNED + 1) == -1);
+    assert(VmLock(vmRegion + 1, PINNED) == -1);
+    assert(vmStats.pinnedPages == 0);
+    assert(VmLock(vmRegion, PINNED) == 0);
+    assert(VmLock(vmRegion, PINNED) == 0);
+    assert(VmLock(vmRegion + PINNED*USLOSS_MmuPageSize(), 1) == -1);
+    assert(vmStats.pinnedPages == PINNED);
+    assert(vmStats.faults == PINNED);
+    assert(vmStats.pinFaults == PINNED);
+    Tconsole("Child(%d): pinned %d pages\n", pid, PINNED);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == PAGES);
+    Tconsole("Child(%d): wrote every page\n", pid);
+
+    for (int page = 0; page < PINNED; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+    assert(vmStats.faults == PAGES);
+    Tconsole("Child(%d): pinned pages stayed in memory\n", pid);
+
+    assert(VmUnlock(vmRegion, PAGES + 1) == -1);
+    assert(VmUnlock(vmRegion, PINNED) == 0);
+    assert(vmStats.pinnedPages == 0);
+
+    // The last pages written are still in memory, so pinning them does
+    // not fault. They are left pinned.
+    assert(VmLock(vmRegion + (PAGES - PINNED)*USLOSS_MmuPageSize(), PINNED) == 0);
+    assert(vmStats.pinnedPages == PINNED);
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 0);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(171);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 171);
+    assert(vmStats.pinnedPages == 0);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
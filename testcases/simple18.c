@@ -0,0 +1,125 @@
+/*
+ * simple18.c
+ *
+ * One process populates pages 0 and 1 with VmPopulate, so writing them
+ * does not fault, and then writes a region twice the size of memory,
+ * which sends pages 0 to 3 to disk. It discards pages 4 to 7 to free the
+ * frames, and populates pages 0 to 3 again, which reads them back from
+ * disk. Reading them then does not fault.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple18"
+#define PAGES       8
+#define CHILDREN    1
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    assert(VmPopulate(vmRegion, 0, 1) == -1);
+    assert(VmPopulate(vmRegion, PAGES + 1, 1) == -1);
+    assert(VmPopulate(vmRegion + 1, 1, 1) == -1);
+    assert(VmPopulate(vmRegion, 2, 1) == 0);
+    assert(vmStats.populated == 2);
+    assert(vmStats.faults == 0);
+    Tconsole("Child(%d): populated pages 0 and 1\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == PAGES - 2);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+    Tconsole("Child(%d): wrote every page\n", pid);
+
+    assert(VmAdvise(vmRegion + FRAMES*USLOSS_MmuPageSize(), PAGES - FRAMES,
+                    VM_ADV_DONTNEED) == 0);
+    assert(VmPopulate(vmRegion, FRAMES, 0) == 0);
+    assert(vmStats.populated == 2 + FRAMES);
+    assert(vmStats.pageIns == FRAMES);
+    Tconsole("Child(%d): populated pages 0 to %d from disk\n", pid, FRAMES - 1);
+
+    for (int page = 0; page < FRAMES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES - 2);
+    assert(vmStats.new == PAGES - 2);
+    assert(vmStats.pageIns == FRAMES);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(181);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 181);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
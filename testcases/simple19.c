@@ -0,0 +1,130 @@
+/*
+ * simple19.c
+ *
+ * One process checks the state of its pages with VmResident as it
+ * writes four pages with two frames, reads page 0 back from disk and
+ * pins it. VmResident itself must never fault.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple19"
+#define PAGES       4
+#define CHILDREN    1
+#define FRAMES      2
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+    char   vec[PAGES];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    assert(VmResident(vmRegion, PAGES, NULL) == -1);
+    assert(VmResident(vmRegion, PAGES, vmRegion) == -1);
+    assert(VmResident(vmRegion, PAGES + 1, vec) == -1);
+    assert(VmResident(vmRegion + 1, 1, vec) == -1);
+    assert(VmResident(vmRegion, PAGES, vec) == 0);
+    for (int page = 0; page < PAGES; page++) {
+        assert(vec[page] == 0);
+    }
+    Tconsole("Child(%d): no page is in use\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(VmResident(vmRegion, PAGES, vec) == 0);
+    assert(vec[0] == VM_RES_ONDISK);
+    assert(vec[1] == VM_RES_ONDISK);
+    assert(vec[2] == (VM_RES_INMEM | VM_RES_DIRTY));
+    assert(vec[3] == (VM_RES_INMEM | VM_RES_DIRTY));
+    assert(vmStats.faults == PAGES);
+    Tconsole("Child(%d): pages 0 and 1 are on disk\n", pid);
+
+    // Reading page 0 replaces page 2, which was written out
+    sprintf(toPrint, "Child(%d): page %d", pid, 0);
+    if (strcmp(vmRegion, toPrint) != 0) {
+        Tconsole("Child(%d): Wrong string read from page 0\n", pid);
+        Tconsole("  read: '%s'\n", vmRegion);
+        USLOSS_Halt(1);
+    }
+    assert(VmLock(vmRegion, 1) == 0);
+    assert(VmResident(vmRegion, PAGES, vec) == 0);
+    assert(vec[0] == (VM_RES_INMEM | VM_RES_ONDISK | VM_RES_PINNED));
+    assert(vec[1] == VM_RES_ONDISK);
+    assert(vec[2] == VM_RES_ONDISK);
+    assert(vec[3] == (VM_RES_INMEM | VM_RES_DIRTY));
+    assert(VmUnlock(vmRegion, 1) == 0);
+    Tconsole("Child(%d): page 0 is back in memory and pinned\n", pid);
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + 1);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 1);
+    assert(vmStats.pageOuts == 3);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(191);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 191);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
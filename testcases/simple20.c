@@ -0,0 +1,123 @@
+/*
+ * simple20.c
+ *
+ * Working set prefetch. One process writes four pages with two frames,
+ * so pages 0 and 1 go to disk, and frees the frames of pages 2 and 3
+ * with VM_ADV_DONTNEED. When it is switched back in after a sleep, the
+ * prefetcher brings pages 0 and 1 back into the free frames, so reading
+ * them does not fault.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple20"
+#define PAGES       4
+#define CHILDREN    1
+#define FRAMES      2
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+    Tconsole("Child(%d): wrote every page\n", pid);
+
+    assert(VmAdvise(vmRegion + FRAMES*USLOSS_MmuPageSize(), PAGES - FRAMES,
+                    VM_ADV_DONTNEED) == 0);
+    assert(vmStats.prefetched == 0);
+
+    // The first sleep marks the working set when the process is switched
+    // back in, and the prefetcher reads it in during the second
+    Sleep(1);
+    Sleep(1);
+    assert(vmStats.prefetched == FRAMES);
+    assert(vmStats.pageIns == FRAMES);
+    Tconsole("Child(%d): pages 0 and 1 were prefetched\n", pid);
+
+    for (int page = 0; page < FRAMES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == FRAMES);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(201);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    SwitchPrefetch = 1;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 201);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
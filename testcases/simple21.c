@@ -0,0 +1,120 @@
+/*
+ * simple21.c
+ *
+ * Page fault frequency allocation. One process writes four pages back
+ * to back, so each fault grows its target resident set until it holds
+ * every frame. It then runs for longer than PFF_SHRINK without faulting,
+ * so its next fault shrinks the target, and the fifth page must replace
+ * one of its own pages.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple21"
+#define PAGES       5
+#define CHILDREN    1
+#define FRAMES      4
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+#define IDLE        60000
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    int    start;
+    int    now;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    for (int page = 0; page < FRAMES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == FRAMES);
+    assert(vmStats.targetGrows == FRAMES - 1);
+    assert(vmStats.targetShrinks == 0);
+    Tconsole("Child(%d): target grew to %d frames\n", pid, FRAMES);
+
+    // Run without faulting so the next fault is far apart from the last
+    GetTimeofDay(&start);
+    do {
+        GetTimeofDay(&now);
+    } while (now - start < IDLE);
+
+    sprintf(toPrint, "Child(%d): page %d", pid, FRAMES);
+    memcpy(vmRegion + FRAMES*USLOSS_MmuPageSize(), toPrint, strlen(toPrint)+1);
+    assert(vmStats.targetShrinks == 1);
+    assert(vmStats.pageOuts == 1);
+    Tconsole("Child(%d): target shrank and page %d replaced its own page\n",
+             pid, FRAMES);
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 0);
+    assert(vmStats.pageOuts == 1);
+    assert(vmStats.targetGrows == FRAMES - 1);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(211);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    FrameAllocation = ALLOC_PFF;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 211);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
@@ -0,0 +1,115 @@
+/*
+ * simple24.c
+ *
+ * Zero page elision. One process writes four pages with two frames, but
+ * clears pages 0 and 1 again after writing them. When they are evicted
+ * they are dropped instead of written out, and reading them back
+ * zero-fills them without reading the disk.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple24"
+#define PAGES       4
+#define CHILDREN    1
+#define FRAMES      2
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+        if (page < FRAMES) {
+            memset(vmRegion + page*USLOSS_MmuPageSize(), 0, strlen(toPrint)+1);
+        }
+    }
+    assert(vmStats.zeroPagesElided == FRAMES);
+    assert(vmStats.pageOuts == 0);
+    Tconsole("Child(%d): pages 0 and 1 were elided\n", pid);
+
+    for (int page = 0; page < FRAMES; page++) {
+        char *region = vmRegion + page*USLOSS_MmuPageSize();
+        for (int i = 0; i < USLOSS_MmuPageSize(); i++) {
+            if (region[i] != 0) {
+                Tconsole("Child(%d): Page %d is not zero at %d\n", pid, page, i);
+                USLOSS_Halt(1);
+            }
+        }
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + FRAMES);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 0);
+    assert(vmStats.pageOuts == PAGES - FRAMES);
+    assert(vmStats.zeroPagesElided == FRAMES);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(241);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    ZeroPageElision = 1;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 241);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
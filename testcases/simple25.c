@@ -0,0 +1,120 @@
+/*
+ * simple25.c
+ *
+ * Shared zero frame. One process reads four pages with three frames.
+ * Every page is mapped to the shared frame of zeros, so no frame is
+ * given out and nothing is written to disk. Writing pages 0 and 1 then
+ * copies each into a private frame of its own.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple25"
+#define PAGES       4
+#define WRITES      2
+#define CHILDREN    1
+#define FRAMES      3
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        if (*(char *) (vmRegion + page*USLOSS_MmuPageSize()) != 0) {
+            Tconsole("Child(%d): Page %d is not zero\n", pid, page);
+            USLOSS_Halt(1);
+        }
+    }
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.zeroFrameMaps == PAGES);
+    assert(vmStats.pageOuts == 0);
+    Tconsole("Child(%d): every page was mapped to the zero frame\n", pid);
+
+    for (int page = 0; page < WRITES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        if (page < WRITES ? strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0 :
+                *(char *) (vmRegion + page*USLOSS_MmuPageSize()) != 0) {
+            Tconsole("Child(%d): Wrong contents read from page %d\n", pid, page);
+            USLOSS_Halt(1);
+        }
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + WRITES);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.cowFaults == WRITES);
+    assert(vmStats.zeroFrameMaps == PAGES);
+    assert(vmStats.pageIns == 0);
+    assert(vmStats.pageOuts == 0);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(251);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    SharedZeroFrame = 1;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 251);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
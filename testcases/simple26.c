@@ -0,0 +1,117 @@
+/*
+ * simple26.c
+ *
+ * Page merging. One process writes the same string to each of eight
+ * pages. The eighth fault wakes the merger, which merges the first seven
+ * pages into one shared read-only frame; the eighth is still being
+ * loaded. Writing a merged page copies it back into a private frame.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple26"
+#define PAGES       8
+#define CHILDREN    1
+#define FRAMES      8
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   *same = "simple26: the same on every page";
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), same,
+               strlen(same)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.faults == PAGES);
+    assert(vmStats.pagesMerged == PAGES - 2);
+    assert(vmStats.framesSaved == PAGES - 2);
+    Tconsole("Child(%d): pages 0 to %d were merged\n", pid, PAGES - 2);
+
+    sprintf(toPrint, "Child(%d): page 0", pid);
+    memcpy(vmRegion, toPrint, strlen(toPrint)+1);
+    assert(vmStats.cowFaults == 1);
+    if (strcmp(vmRegion, toPrint) != 0) {
+        Tconsole("Child(%d): Wrong string read from page 0\n", pid);
+        USLOSS_Halt(1);
+    }
+    for (int page = 1; page < PAGES; page++) {
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), same) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + 1);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 0);
+    assert(vmStats.pageOuts == 0);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(261);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    PageMerging = 1;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 261);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
@@ -0,0 +1,126 @@
+/*
+ * simple28.c
+ *
+ * Swap I/O scheduler. One process writes four pages with two frames and
+ * reads pages 0 and 1 back. Each fault waits for its I/O, so the
+ * scheduler only ever has one request for the disk, and the head visits
+ * the swap blocks in the order they are used: 0, 1, 2, 0, 3, 1.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple28"
+#define PAGES       4
+#define CHILDREN    1
+#define FRAMES      2
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+static int blocks[] = { 0, 1, 2, 0, 3, 1 };
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    int    sectorSize;
+    int    trackSize;
+    int    diskSize;
+    int    head = 0;
+    int    tracks = 0;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+
+    for (int page = 0; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(vmStats.seeks == PAGES - FRAMES);
+
+    for (int page = 0; page < FRAMES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+
+    // The head of the swap disk, unit 1, starts on track 0 and moves to
+    // the track of each block
+    DiskSize(1, &sectorSize, &trackSize, &diskSize);
+    for (int i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+        int track = blocks[i] * (USLOSS_MmuPageSize() / sectorSize) / trackSize;
+        tracks += track > head ? track - head : head - track;
+        head = track;
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + FRAMES);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == FRAMES);
+    assert(vmStats.pageOuts == PAGES);
+    assert(vmStats.seeks == vmStats.pageIns + vmStats.pageOuts);
+    assert(vmStats.seekTracks == tracks);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(281);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    SwapScheduler = 1;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 281);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
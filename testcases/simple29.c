@@ -0,0 +1,125 @@
+/*
+ * simple29.c
+ *
+ * Log-structured swap. The swap disk has 64 blocks in log segments of 8.
+ * One process writes 50 pages with two frames, so pages 0 to 47 fill
+ * blocks 0 to 47, then drops pages 0 to 4 with VM_ADV_DONTNEED, leaving
+ * three live blocks in the first segment. Writing six more pages leaves
+ * fewer than a quarter of the blocks free, which wakes the cleaner. It
+ * moves the three live blocks to the log head, and they read back intact.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase5.h>
+#include <libuser.h>
+#include <string.h>
+#include <assert.h>
+
+#define Tconsole USLOSS_Console
+
+#define TEST        "simple29"
+#define PAGES       56
+#define CHILDREN    1
+#define FRAMES      2
+#define FILLED      50
+#define DROPPED     5
+#define PRIORITY    5
+#define ITERATIONS  1
+#define PAGERS      1
+#define MAPPINGS    PAGES
+
+extern void *vmRegion;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int
+Child(char *arg)
+{
+    int    pid;
+    char   toPrint[64];
+
+    GetPID(&pid);
+    Tconsole("\nChild(%d): starting\n", pid);
+    assert(vmStats.diskBlocks == 64);
+
+    for (int page = 0; page < FILLED; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    assert(VmAdvise(vmRegion, DROPPED, VM_ADV_DONTNEED) == 0);
+    assert(vmStats.segmentsCleaned == 0);
+    Tconsole("Child(%d): dropped pages 0 to %d\n", pid, DROPPED - 1);
+
+    for (int page = FILLED; page < PAGES; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        memcpy(vmRegion + page*USLOSS_MmuPageSize(), toPrint,
+               strlen(toPrint)+1);  // +1 to copy nul character
+    }
+    Sleep(1);  // the cleaner does its own disk I/O
+    assert(vmStats.segmentsCleaned == 1);
+    assert(vmStats.runsMoved == 8 - DROPPED);
+    Tconsole("Child(%d): the first segment was cleaned\n", pid);
+
+    for (int page = DROPPED; page < 8; page++) {
+        sprintf(toPrint, "Child(%d): page %d", pid, page);
+        if (strcmp(vmRegion + page*USLOSS_MmuPageSize(), toPrint) != 0) {
+            Tconsole("Child(%d): Wrong string read from page %d\n", pid, page);
+            Tconsole("  read: '%s'\n", vmRegion + page*USLOSS_MmuPageSize());
+            USLOSS_Halt(1);
+        }
+    }
+
+    Tconsole("Child(%d): checking various vmStats\n", pid);
+    assert(vmStats.faults == PAGES + 8 - DROPPED);
+    assert(vmStats.new == PAGES);
+    assert(vmStats.pageIns == 8 - DROPPED);
+    assert(vmStats.segmentsCleaned == 1);
+
+    Tconsole("Child(%d): terminating\n\n", pid);
+
+    Terminate(291);
+    return 0;
+} /* Child */
+
+
+int
+start5(char *arg)
+{
+    int  pid;
+    int  status;
+
+    Tconsole("start5(): Running:    %s\n", TEST);
+    Tconsole("start5(): Pagers:     %d\n", PAGERS);
+    Tconsole("          Mappings:   %d\n", MAPPINGS);
+    Tconsole("          Pages:      %d\n", PAGES);
+    Tconsole("          Frames:     %d\n", FRAMES);
+    Tconsole("          Children:   %d\n", CHILDREN);
+    Tconsole("          Iterations: %d\n", ITERATIONS);
+    Tconsole("          Priority:   %d\n", PRIORITY);
+
+    LogSwap = 1;
+    status = VmInit( MAPPINGS, PAGES, FRAMES, PAGERS, &vmRegion );
+    Tconsole("start5(): after call to VmInit, status = %d\n\n", status);
+    assert(status == 0);
+    assert(vmRegion != NULL);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK * 7, PRIORITY, &pid);
+
+    Wait(&pid, &status);
+    assert(status == 291);
+
+    Tconsole("start5(): done\n");
+    VmDestroy();
+    Terminate(1);
+
+    return 0;
+} /* start5 */
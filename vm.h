@@ -11,6 +11,89 @@
 #define TRUE 1
 
 #define SWAPDISK 1
+
+/*
+ * Load control. Every LOAD_WINDOW microseconds the share of time spent
+ * handling faults is compared against these percentages.
+ */
+#define LOAD_WINDOW 100000
+#define THRASH_HIGH 50
+#define THRASH_LOW  20
+#define LOAD_MONITOR_PRIORITY 3
+
+/*
+ * Page fault frequency allocation. A process whose faults come less than
+ * PFF_GROW microseconds of virtual time apart has its target resident set
+ * grown; one whose faults are more than PFF_SHRINK apart has it shrunk.
+ */
+#define PFF_GROW   5000
+#define PFF_SHRINK 50000
+/*
+ * Adaptive pager pool. A pager beyond the number given to VmInit retires
+ * once the pool has gone POOL_IDLE microseconds without growing and no
+ * faults are queued. An idle pager is told to retire with POOL_RETIRE in
+ * place of a pid.
+ */
+#define POOL_IDLE   100000
+#define POOL_RETIRE -2
+
+/*
+ * Working set prefetch. At most PREFETCH_PAGES pages of a process are
+ * brought in when it returns from being switched out.
+ */
+#define PREFETCH_PAGES      8
+#define PREFETCHER_PRIORITY 3
+
+/*
+ * Page pinning. A process may pin PIN_PROCESS_PERCENT of its frame cap,
+ * and at most PIN_GLOBAL_PERCENT of the frames may be pinned in all.
+ */
+#define PIN_PROCESS_PERCENT 50
+#define PIN_GLOBAL_PERCENT  50
+
+/*
+ * Idle swap-out. The swapper looks for idle processes every
+ * SWAPPER_TICKS clock interrupts, and writes up to SWAP_CLUSTER
+ * neighbouring dirty pages of a process in one request. Phase 1 runs its
+ * sentinel, which only runs when every other process is blocked, as
+ * SENTINEL_PID.
+ */
+#define SWAPPER_TICKS    5
+#define SWAPPER_PRIORITY 3
+#define SWAP_CLUSTER     4
+#define SENTINEL_PID     1
+
+/*
+ * Swap I/O scheduling. A queued read that has waited READ_DEADLINE
+ * microseconds is dispatched ahead of the elevator order.
+ */
+#define READ_DEADLINE 50000
+
+/*
+ * Swap extents. An extent is EXTENT_TRACKS tracks of adjacent blocks on one
+ * swap disk. A swap read brings in up to READ_AHEAD blocks of the extent.
+ */
+#define EXTENT_TRACKS 4
+#define READ_AHEAD    4
+
+/*
+ * Log-structured swap. The swap blocks are grouped into log segments of
+ * LOG_SEGMENT blocks. The cleaner is woken when fewer than LOG_CLEAN_FREE
+ * percent of the blocks are free, and compacts the segments with the least
+ * live data until LOG_CLEAN_TARGET percent are free.
+ */
+#define LOG_SEGMENT      8
+#define LOG_CLEAN_FREE   25
+#define LOG_CLEAN_TARGET 40
+#define CLEANER_PRIORITY 4
+
+/*
+ * Page merging. The merger makes a pass over the frames every
+ * MERGE_INTERVAL faults.
+ */
+#define MERGE_INTERVAL  8
+#define MERGER_PRIORITY 4
+
 /*
  * All processes use the same tag.
  */
@@ -23,6 +106,12 @@
 #define INMEM  501
 #define ONDISK 502
 
+/*
+ * Lists a frame can belong to under the CAR replacement policy.
+ */
+#define CAR_T1 600   // Pages referenced once recently
+#define CAR_T2 601   // Pages referenced more than once recently
+
 /*
  * Page table entry.
  */
@@ -31,8 +120,35 @@ typedef struct PTE
     int  state;      // See above.
     int  frame;      // Frame that stores the page (if any). -1 if none.
     int  diskBlock;  // Disk block that stores the page (if any). -1 if none.
+    int  diskSector; // First sector of the page within its disk block
+    int  diskSectors;// # sectors the page occupies on disk
+    int  lastRef;    // Virtual time of the owner when the page was last referenced
+    int  cow;        // Whether the frame is shared read-only and copied on write
+    int  segment;    // Shared segment attached at this page, EMPTY if none
+    int  segmentPage;// Page of the shared segment
+    int  mapUnit;    // Disk unit the page is mapped from, EMPTY if none
+    int  mapSector;  // First sector of the page on the mapped disk
+    int  loading;    // Whether the page is moving between a frame and disk
+    int  advice;     // Access pattern advised by VmAdvise
+    int  pinned;     // Whether VmLock has pinned the page in memory
 } PTE;
 
+/*
+ * Shared memory segments. The page table of a segment says where each of
+ * its pages is kept; the pages of the processes it is attached to only
+ * mirror whether a page is in memory, and in which frame.
+ */
+#define MAXSEGMENTS      10
+#define SEGMENT_NAME_LEN 16
+
+typedef struct Segment
+{
+    char name[SEGMENT_NAME_LEN]; // Empty if the slot is free
+    int  pages;                  // Size of the segment, in pages
+    int  attached;               // # processes the segment is attached to
+    PTE  *pageTable;             // Where each page of the segment is kept
+} Segment;
+
 /*
  * Per-process information.
  */
@@ -41,6 +157,23 @@ typedef struct Process
     int pid;                // The pid of the process stored in this entry
     PTE *pageTable;         // The page table for the process.
     int privateSem;         // The id of the private mailbox used to block this process
+    int virtualTime;        // CPU time used by the process while VM was running
+    int switchedIn;         // Time the process was last switched in
+    int deactivated;        // Order in which load control deactivated the process, 0 if active
+    int held;               // Whether the process is blocked waiting to be reactivated
+    int faults;             // # page faults taken by the process
+    int lastFault;          // Virtual time of the process's previous fault
+    int targetFrames;       // Target resident set size under PFF allocation
+    int minFrames;          // # frames reserved for the process
+    int maxFrames;          // Most frames the process may hold
+    int wantPrefetch;       // Whether its working set should be prefetched
+    int prefetching;        // # prefetches of its pages in progress
+    int quitting;           // Whether the process has started to quit
+    int unloaded;           // Whether its mappings were unloaded for good as it quits
+    int blockedSince;       // Time it was first seen blocked since it last ran, EMPTY if not
+    int idleSwapped;        // Whether it was swapped out since it last ran
+    int pinnedPages;        // # pages pinned by VmLock, including reserved pins
+    int pinsReserved;       // # pins VmLock has counted but not yet made
 } Process;
 
 /*
@@ -51,11 +184,33 @@ typedef struct FaultMsg
 {
     int  pid;            // Process with the problem.
     void *addr;          // Address that caused the fault.
-    int receivedFrame;   // The frame returned to the process
+    int cause;           // USLOSS_MMU_FAULT, or USLOSS_MMU_ACCESS for a write
+                         //   to a read-only page
+    int receivedFrame;   // The frame returned to the process (EMPTY if shared)
     int failed;          // True if the assignment failed
     int shouldTerminate; // True if the sufferer should be terminated
 } FaultMsg;
 
+/*
+ * The rest of a fault once its frame is chosen. A pager passes this to a
+ * pager worker, which does the disk I/O and wakes the faulting process.
+ */
+typedef struct PageJob
+{
+    int pid;                  // Faulting process, -1 to kill the worker
+    int incomingPage;         // Page being brought in
+    int frame;                // Locked frame the page goes into
+    int sharedFrame;          // Frame the page shared before a copy on write
+    int copyOnWrite;          // Whether the page is copied from sharedFrame
+    int holdShared;           // Whether sharedFrame is locked for the copy
+    int attached;             // Whether the page is a shared segment page
+    int mapped;               // Whether the page is in a mapped disk region
+    int incomingPageExists;   // Whether the page has been used before
+    int incomingPageReplaced; // Whether the page was replaced earlier
+    int faultStart;           // Time the pager took the fault
+    int prefetch;             // Whether no process is waiting for the page
+} PageJob;
+
 /*
  * A frame in the global frame table.
  */
@@ -64,6 +219,9 @@ typedef struct Frame
     int page;       // The page loaded into this frame
     int pid;        // The proc that currently owns this frame
     int locked;     // Whether the frame is locked
+    int list;       // The CAR list holding this frame (EMPTY if none)
+    int warm;       // Whether the page was referenced during an earlier T1 sweep
+    int sharers;    // # pages sharing the frame read-only, 0 if it is private
 } Frame;
 
 extern int vmStatsMutex;